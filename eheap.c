@@ -9,42 +9,288 @@
 /*******************************************************************************
  * Include files
  ******************************************************************************/
+#define _GNU_SOURCE                       // POSIX parts: mmap, mremap, msync, ftruncate, clock_gettime
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
 
 #include "eheap.h"
 
+#if EHEAP_USE_PTHREAD
+#include <pthread.h>
+#endif
+#if EHEAP_USE_PROFILER
+#include "eheap_prof.h"
+#endif
+#if EHEAP_USE_PERSIST
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#if EHEAP_USE_PERSIST || EHEAP_USE_MMAP_LARGE
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#if EHEAP_USE_OPSTATS && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#elif EHEAP_USE_OPSTATS && !defined(__aarch64__)
+#include <time.h>
+#endif
+
 
 /*******************************************************************************
  * Local pre-processor symbols/macros ('#define')
  ******************************************************************************/
+#define EHEAP_PROF_TAG     ((eheap_link_t)1) // next of allocated block, block is sampled
+#define EHEAP_PERSIST_MAGIC   0x53504845u  // "EHPS"
+#define EHEAP_PERSIST_VERSION 1u
+#define EHEAP_BUDDY_FREE      ((size_t)1)  // size flag of free buddy block
+#define EHEAP_BUDDY_MIN_ORDER 5            // 32 byte blocks hold header and both free list links
+#define EHEAP_BUDDY_ORDERS    (sizeof(size_t) * 8)
+#define EHEAP_BUDDY_PREV(block) ((eheap_link_t*)((block) + 1)) // back link of free buddy block
+
+#define EHEAP_STATS_WORDS     (sizeof(eheap_stats_t) / sizeof(size_t)) // snapshot is copied word by word
+#define EHEAP_TREE_BY_SIZE    0            // index of free blocks by (size, address)
+#define EHEAP_TREE_BY_ADDR    1            // index of free blocks by address
+#define EHEAP_TREE_NODE(block) ((eheap_tree_node_t*)(block))
+#if EHEAP_USE_TREE_INDEX
+#define EHEAP_MIN_BLOCK       sizeof(eheap_tree_node_t) // any block may become free and hold tree node
+#else
+#define EHEAP_MIN_BLOCK       (sizeof(eheap_free_block_t) + EHEAP_ALIGNMENT)
+#endif
+
+_Static_assert(sizeof(eheap_stats_t) % sizeof(size_t) == 0, "eheap_stats_t must hold only size_t counters");
+_Static_assert((EHEAP_ALIGNMENT & (EHEAP_ALIGNMENT - 1)) == 0 && sizeof(eheap_free_block_t) % EHEAP_ALIGNMENT == 0,
+               "EHEAP_ALIGNMENT must be power of two dividing block header size, user pointer follows header");
+#if EHEAP_ENGINE == EHEAP_ENGINE_BUDDY && EHEAP_USE_PERSIST
+#error "EHEAP_USE_PERSIST requires EHEAP_ENGINE_BESTFIT"
+#endif
+#if EHEAP_ENGINE == EHEAP_ENGINE_BUDDY && EHEAP_USE_TREE_INDEX
+#error "EHEAP_USE_TREE_INDEX requires EHEAP_ENGINE_BESTFIT"
+#endif
+
+#if EHEAP_USE_OPSTATS
+#define EHEAP_OP_BEGIN()   uint64_t op_start = eheap_cycles(); size_t op_nodes = eheap_op_nodes
+#define EHEAP_OP_END(op)   eheap_op_record(&eheap_ext_stats.op, op_start, op_nodes)
+#define EHEAP_NODE_VISIT() (eheap_op_nodes++)
+#define EHEAP_ATOMIC_MAX(ptr, value) do { __typeof__(*(ptr)) seen = __atomic_load_n((ptr), __ATOMIC_RELAXED); \
+  while ((value) > seen && !__atomic_compare_exchange_n((ptr), &seen, (value), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)); } while (0)
+#else
+#define EHEAP_OP_BEGIN()
+#define EHEAP_OP_END(op)
+#define EHEAP_NODE_VISIT()
+#endif
+
+#if EHEAP_USE_PROFILER
+#define EHEAP_PROF_ENTER() bool prof_outer = (eheap_prof_caller == NULL); \
+                           if (prof_outer) eheap_prof_caller = __builtin_return_address(0)
+#define EHEAP_PROF_LEAVE() if (prof_outer) eheap_prof_caller = NULL
+#else
+#define EHEAP_PROF_ENTER()
+#define EHEAP_PROF_LEAVE()
+#endif
+
+#if EHEAP_USE_PRESSURE
+#define EHEAP_FIT_FAILED(failed)             eheap_fit_failed = (failed)
+#define EHEAP_RECLAIM_RETRY(ptr, size, call) if (!(ptr) && eheap_fit_failed && eheap_pressure_reclaim(size)) (ptr) = (call)
+#define EHEAP_WATERMARK_FIRE()               eheap_watermark_fire()
+#else
+#define EHEAP_FIT_FAILED(failed)
+#define EHEAP_RECLAIM_RETRY(ptr, size, call)
+#define EHEAP_WATERMARK_FIRE()
+#endif
 /*******************************************************************************
  * Global variable definitions (declared in header file with 'extern')
  ******************************************************************************/
+#if EHEAP_USE_FASTPATH
+EHEAP_TLS eheap_fast_bin_t eheap_fast_bins[EHEAP_FAST_CLASSES] = {0}; // this thread's size class caches
+EHEAP_TLS size_t eheap_fast_bins_generation = 0; // heap generation caches were set up in, 0 - none
+size_t eheap_fast_generation = 1;               // bumped when heap is replaced, written with heap locked
+#endif
 /*******************************************************************************
  * Local function prototypes ('static')
  ******************************************************************************/
 /*******************************************************************************
  * Local types definitions
  ******************************************************************************/
+#if EHEAP_USE_MMAP_LARGE
+typedef struct {
+  uint8_t* base;                     // NULL - slot is free
+  size_t length;                     // mapping length
+  size_t offset;                     // mapping start to user pointer
+  bool busy;                         // resize in progress without heap lock
+} eheap_mmap_region_t;
+#endif
+#if EHEAP_USE_TREE_INDEX
+typedef struct {
+  eheap_free_block_t hdr;            // size and next free block by address
+  eheap_link_t child[2][2];          // [EHEAP_TREE_BY_SIZE/BY_ADDR][0 - lower key, 1 - higher key]
+} eheap_tree_node_t;
+#endif
+#if EHEAP_USE_PRESSURE
+typedef struct {
+  eheap_pressure_handler_t handler;
+  void* ctx;
+  int priority;
+} eheap_pressure_entry_t;
+
+typedef struct {
+  eheap_watermark_handler_t handler; // NULL - no crossing pending
+  void* ctx;
+  bool high;
+  size_t usage;
+} eheap_watermark_event_t;
+#endif
+#if EHEAP_USE_PERSIST
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t map_size;                 // whole file
+  uint64_t heap_offset;              // file start to heap region
+  uint64_t heap_size;
+  eheap_link_t free_head;            // link to first free block
+  eheap_link_t root;                 // link to root object
+} eheap_persist_hdr_t;
+#endif
 /*******************************************************************************
  * Local variable definitions ('static')
  ******************************************************************************/
-static uint8_t eheap[EHEAP_SIZE] = {0};
-static eheap_free_block_t* eheap_free_list = NULL;
-static eheap_stats_t eheap_stats = {0};
-//static eheap_mutex_t eheap_mutex;       // Platform-specific mutex
+static _Alignas(EHEAP_ALIGNMENT) uint8_t eheap[EHEAP_SIZE] = {0};
+static uint8_t* eheap_mem = eheap;              // active heap region
+static size_t eheap_mem_size = EHEAP_SIZE;      // active heap region size
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+static eheap_link_t eheap_free_head_slot = 0;
+static eheap_link_t* eheap_free_head = &eheap_free_head_slot; // link to first free block
+#if EHEAP_USE_TREE_INDEX
+static eheap_link_t eheap_tree_size_root = 0;    // free blocks by (size, address)
+static eheap_link_t eheap_tree_addr_root = 0;    // free blocks by address
+#define EHEAP_TREE_ROOT(tree) ((tree) == EHEAP_TREE_BY_SIZE ? &eheap_tree_size_root : &eheap_tree_addr_root)
+static size_t eheap_tree_free_bytes = 0;
+static size_t eheap_tree_free_count = 0;
+#endif
+#else
+static eheap_link_t eheap_buddy_heads[EHEAP_BUDDY_ORDERS]; // free list per order
+static size_t eheap_buddy_mask = 0;             // bit k set - order k list is not empty
+static size_t eheap_buddy_free_bytes = 0;
+static size_t eheap_buddy_free_count = 0;
+#endif
+static eheap_stats_t eheap_stats = {0};         // updated with heap locked
+static atomic_size_t eheap_stats_snapshot[EHEAP_STATS_WORDS]; // published copy of eheap_stats for lock-free readers
+static atomic_size_t eheap_stats_mem_size = 0;  // region size published with snapshot
+static atomic_size_t eheap_stats_seq = 0;       // snapshot sequence, odd while being written
+#if EHEAP_USE_OPSTATS
+static eheap_ext_stats_t eheap_ext_stats = {0};  // per-operation part only, updated with atomics
+static EHEAP_TLS size_t eheap_op_nodes = 0; // free list nodes visited by this thread
+#endif
+#if EHEAP_USE_PROFILER
+static EHEAP_TLS void* eheap_prof_caller = NULL; // return address of outermost allocator entry
+#endif
+#if EHEAP_USE_PTHREAD
+static pthread_mutex_t eheap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool eheap_atfork_registered = false;
+#endif
+#if EHEAP_USE_FASTPATH && EHEAP_USE_PTHREAD
+static pthread_once_t eheap_fast_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t eheap_fast_key;            // destructor flushes caches of exiting thread
+#endif
+#if EHEAP_USE_PERSIST
+static eheap_persist_hdr_t* eheap_persist_hdr = NULL; // mapped file, NULL - static heap active
+static int eheap_persist_fd = -1;
+#endif
+#if EHEAP_USE_MMAP_LARGE
+static eheap_mmap_region_t eheap_mmap_regions[EHEAP_MMAP_MAX_REGIONS];
+#endif
+#if EHEAP_USE_PRESSURE
+static eheap_pressure_entry_t eheap_pressure_handlers[EHEAP_PRESSURE_MAX_HANDLERS]; // descending priority
+static size_t eheap_pressure_count = 0;
+static size_t eheap_watermark_high = 0;
+static size_t eheap_watermark_low = 0;
+static eheap_watermark_handler_t eheap_watermark_handler = NULL; // NULL - watermarks disabled
+static void* eheap_watermark_ctx = NULL;
+static bool eheap_watermark_above = false;      // high mark crossed, low mark not yet
+static EHEAP_TLS bool eheap_pressure_busy = false; // this thread runs reclaim handlers
+static EHEAP_TLS bool eheap_fit_failed = false;    // last eheap_do_* alloc found no free block
+static EHEAP_TLS eheap_watermark_event_t eheap_watermark_event = {0}; // crossing seen by this thread
+#endif
 
 /*******************************************************************************
  * Local function prototypes
  ******************************************************************************/
 static void eheap_lock(void);
 static void eheap_unlock(void);
+static void eheap_stats_publish(void);
+static void eheap_stats_read(eheap_stats_t* stats, size_t* mem_size);
+static void eheap_count_failure(void);
+static bool eheap_check(void);
+#if EHEAP_USE_PTHREAD
+static void eheap_atfork_prepare(void);
+static void eheap_atfork_parent(void);
+static void eheap_atfork_child(void);
+#endif
+static eheap_free_block_t* eheap_link_get(const eheap_link_t* link);
+static void eheap_link_set(eheap_link_t* link, eheap_free_block_t* block);
 static void eheap_update_stats(void);
+static void eheap_format(void);
 bool eheap_validate_ptr(void* ptr);
-static void eheap_defragment(void);
+static void* eheap_do_alloc(size_t size);
+static void* eheap_do_alloc_aligned(size_t alignment, size_t size);
+static void* eheap_do_alloc_hint(size_t size, unsigned int flags);
+static void* eheap_do_realloc(void* ptr, size_t old_size_hint, size_t new_size);
+static void eheap_do_free(void* ptr);
+static void eheap_do_free_sized(void* ptr, size_t size);
+static bool eheap_in_arena(void* ptr);
+static bool eheap_arena_user_ptr(void* ptr);
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+static void eheap_list_insert(eheap_link_t* link, eheap_free_block_t* block);
+static void eheap_list_remove(eheap_link_t* link);
+static void eheap_list_trim(eheap_link_t* link, size_t cut);
+static bool eheap_alloc_begin(size_t size, size_t* total_size);
+static void* eheap_alloc_finish(eheap_link_t* fit, size_t gap, size_t total_size, size_t size);
+static size_t eheap_align_gap(eheap_free_block_t* block, size_t alignment);
+static void eheap_release_block(eheap_free_block_t* block);
+static bool eheap_block_sane(eheap_free_block_t* block);
+#if EHEAP_USE_TREE_INDEX
+static void eheap_tree_insert(eheap_link_t* slot, eheap_free_block_t* block, int tree);
+static void eheap_tree_remove(eheap_free_block_t* block, int tree);
+static eheap_free_block_t* eheap_tree_find(size_t size);
+static eheap_free_block_t* eheap_tree_floor(void* ptr);
+static bool eheap_tree_locate(eheap_free_block_t* block, eheap_free_block_t* moved, size_t size, int tree, eheap_link_t** slot);
+#if EHEAP_USE_PERSIST
+static void eheap_tree_rebuild(void);
+#endif
+static bool eheap_tree_check(eheap_free_block_t* top, int tree, eheap_free_block_t* low, eheap_free_block_t* high, size_t* count);
+static eheap_link_t* eheap_list_slot(eheap_free_block_t* block);
+#endif
+#else
+static size_t eheap_buddy_order(size_t size);
+static void eheap_buddy_push(eheap_free_block_t* block, size_t order);
+static void eheap_buddy_remove(eheap_free_block_t* block, size_t order);
+static eheap_free_block_t* eheap_buddy_take(size_t order);
+static bool eheap_buddy_grow(eheap_free_block_t* block, size_t order);
+static eheap_free_block_t* eheap_buddy_owner(eheap_free_block_t* header);
+static void eheap_buddy_release(eheap_free_block_t* block);
+static bool eheap_buddy_check(size_t* total_free);
+#endif
+#if EHEAP_USE_MMAP_LARGE
+static eheap_mmap_region_t* eheap_mmap_find(void* ptr);
+static void* eheap_mmap_alloc(size_t size, size_t alignment);
+static void* eheap_mmap_realloc(void* ptr, size_t new_size);
+static bool eheap_mmap_free(void* ptr);
+static void eheap_mmap_release_all(void);
+#endif
+#if EHEAP_USE_FASTPATH
+static void eheap_fast_attach(void);
+#if EHEAP_USE_PTHREAD
+static void eheap_fast_key_create(void);
+static void eheap_fast_thread_exit(void* arg);
+#endif
+#endif
+#if EHEAP_USE_PRESSURE
+static void eheap_watermark_update(void);
+static void eheap_watermark_fire(void);
+static bool eheap_pressure_reclaim(size_t size);
+#endif
 
 /*******************************************************************************
  * Function implementation
@@ -56,9 +302,17 @@ static void eheap_defragment(void);
  ******************************************************************************/
 static void eheap_init_mutex(void)
 {
+#if EHEAP_USE_PTHREAD
+  if (!eheap_atfork_registered) // Keep heap usable in child after fork
+  {
+    eheap_atfork_registered = true;
+    pthread_atfork(eheap_atfork_prepare, eheap_atfork_parent, eheap_atfork_child);
+  }
+#else
   // Platform-specific mutex initialization
   // Example: pthread_mutex_init(&eheap_mutex, NULL);
   // Or: InitializeCriticalSection(&eheap_mutex);
+#endif
 }
 
 /*******************************************************************************
@@ -68,9 +322,13 @@ static void eheap_init_mutex(void)
  ******************************************************************************/
 static void eheap_lock(void)
 {
+#if EHEAP_USE_PTHREAD
+  pthread_mutex_lock(&eheap_mutex);
+#else
   // Platform-specific mutex lock
   // pthread_mutex_lock(&eheap_mutex);
   // Or: EnterCriticalSection(&eheap_mutex);
+#endif
 }
 
 /*******************************************************************************
@@ -80,310 +338,1960 @@ static void eheap_lock(void)
  ******************************************************************************/
 static void eheap_unlock(void)
 {
+  eheap_stats_publish();
+#if EHEAP_USE_PTHREAD
+  pthread_mutex_unlock(&eheap_mutex);
+#else
   // Platform-specific mutex unlock
   // pthread_mutex_unlock(&eheap_mutex);
   // Or: LeaveCriticalSection(&eheap_mutex);
+#endif
 }
 
 /*******************************************************************************
- ** \brief  Align size to EHEAP_ALIGNMENT
+ ** \brief  Publish statistics snapshot, writer side of seqlock. Runs on every
+ **         unlock, so readers see state of last completed locked section.
  ** \param  None
  ** \retval None
  ******************************************************************************/
-static size_t eheap_align_up(size_t size)
+static void eheap_stats_publish(void)
 {
-  return (size + EHEAP_ALIGNMENT - 1) & ~(EHEAP_ALIGNMENT - 1);
+  const size_t* src = (const size_t*)&eheap_stats;
+  size_t seq = atomic_load_explicit(&eheap_stats_seq, memory_order_relaxed);
+  atomic_store_explicit(&eheap_stats_seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  for (size_t i = 0; i < EHEAP_STATS_WORDS; i++) atomic_store_explicit(&eheap_stats_snapshot[i], src[i], memory_order_relaxed);
+  atomic_store_explicit(&eheap_stats_mem_size, eheap_mem_size, memory_order_relaxed);
+  atomic_store_explicit(&eheap_stats_seq, seq + 2, memory_order_release);
 }
 
 /*******************************************************************************
- ** \brief  Update heap statistics
- ** \param  None
+ ** \brief  Read consistent statistics snapshot without taking heap lock,
+ **         retries while writer is publishing
+ ** \param  stats - output, mem_size - output region size or NULL
  ** \retval None
  ******************************************************************************/
-static void eheap_update_stats(void)
+static void eheap_stats_read(eheap_stats_t* stats, size_t* mem_size)
 {
-  size_t free_memory = 0;
-  size_t largest_block = 0;
-  size_t free_blocks_count = 0;
-  eheap_free_block_t* current = eheap_free_list;
-  while (current) 
+  size_t* dst = (size_t*)stats;
+  size_t seq;
+  size_t size;
+  do
   {
-    free_memory += current->size;
-    free_blocks_count++;
-    if (current->size > largest_block) largest_block = current->size;
-    current = current->next;
-  }
-  eheap_stats.current_usage = EHEAP_SIZE -free_memory;
-  eheap_stats.largest_free_block = largest_block;
-  if (eheap_stats.current_usage > eheap_stats.peak_usage) eheap_stats.peak_usage = eheap_stats.current_usage;
-  if (free_blocks_count > 1) eheap_stats.fragmentation = (free_blocks_count * 100) / (EHEAP_SIZE / sizeof(eheap_free_block_t));
-  else                       eheap_stats.fragmentation = 0;
+    seq = atomic_load_explicit(&eheap_stats_seq, memory_order_acquire);
+    for (size_t i = 0; i < EHEAP_STATS_WORDS; i++) dst[i] = atomic_load_explicit(&eheap_stats_snapshot[i], memory_order_relaxed);
+    size = atomic_load_explicit(&eheap_stats_mem_size, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+  } while ((seq & 1) || seq != atomic_load_explicit(&eheap_stats_seq, memory_order_relaxed));
+  if (mem_size) *mem_size = size;
 }
 
 /*******************************************************************************
- ** \brief  Defragment heap by merging adjacent free blocks
+ ** \brief  Count allocation rejected before heap was locked
  ** \param  None
  ** \retval None
  ******************************************************************************/
-static void eheap_defragment(void)
+static void eheap_count_failure(void)
 {
-  eheap_free_block_t* current = eheap_free_list;
-  while (current && current->next) 
-  {
-    uint8_t* current_end = (uint8_t*)current + current->size;
-    if (current_end == (uint8_t*)current->next) 
-    {
-      current->size += current->next->size;
-      current->next = current->next->next;
-    } 
-    else 
-    {
-      current = current->next;
-    }
-  }
+  eheap_lock();
+  eheap_stats.alloc_failures++;
+  eheap_unlock();
 }
 
+#if EHEAP_USE_PTHREAD
 /*******************************************************************************
- ** \brief  Validate pointer before freeing
+ ** \brief  Fork handlers, heap lock is held across fork so child gets
+ **         consistent free list and fresh mutex
  ** \param  None
  ** \retval None
  ******************************************************************************/
-bool eheap_validate_ptr(void* ptr)
+static void eheap_atfork_prepare(void)
 {
-  if(!ptr) return false;
-  uint8_t* heap_start = eheap;
-  uint8_t* heap_end = eheap + EHEAP_SIZE;
-  uint8_t* test_ptr = (uint8_t*)ptr;
-  if(test_ptr < heap_start || test_ptr >= heap_end) return false; // Check if pointer is within heap bounds
-  if(((uintptr_t)ptr & (EHEAP_ALIGNMENT - 1)) != 0) return false; // Check alignment
-  return true;
+#if EHEAP_USE_PROFILER
+  eheap_prof_atfork_prepare(); // Sample table lock is taken before heap lock
+#endif
+  pthread_mutex_lock(&eheap_mutex);
+}
+
+static void eheap_atfork_parent(void)
+{
+  pthread_mutex_unlock(&eheap_mutex);
+#if EHEAP_USE_PROFILER
+  eheap_prof_atfork_parent();
+#endif
+}
+
+static void eheap_atfork_child(void)
+{
+  pthread_mutex_init(&eheap_mutex, NULL);
+#if EHEAP_USE_PROFILER
+  eheap_prof_atfork_child();
+#endif
 }
+#endif
 
 /*******************************************************************************
- ** \brief  Initialize heap
+ ** \brief  Resolve self-relative link. Links hold distance from the link field
+ **         itself, so heap region stays valid when mapped at another address.
+ ** \param  link - link field
+ ** \retval Linked block or NULL
+ ******************************************************************************/
+static eheap_free_block_t* eheap_link_get(const eheap_link_t* link)
+{
+  if (*link == 0) return NULL;
+  return (eheap_free_block_t*)((uintptr_t)link + (uintptr_t)*link); // Integer math, target is not within link object
+}
+
+/*******************************************************************************
+ ** \brief  Point link to block
+ ** \param  link - link field, block - target block or NULL
+ ** \retval None
+ ******************************************************************************/
+static void eheap_link_set(eheap_link_t* link, eheap_free_block_t* block)
+{
+  *link = block ? (eheap_link_t)((uint8_t*)block - (uint8_t*)link) : 0;
+}
+
+/*******************************************************************************
+ ** \brief  Align size to EHEAP_ALIGNMENT
  ** \param  None
  ** \retval None
  ******************************************************************************/
-void eheap_init(void)
+static size_t eheap_align_up(size_t size)
 {
-  eheap_init_mutex();
-  eheap_lock();
-  memset(eheap, 0, EHEAP_SIZE);
-  eheap_free_list = (eheap_free_block_t*)eheap;
-  eheap_free_list->size = EHEAP_SIZE;
-  eheap_free_list->next = NULL;
-  memset(&eheap_stats, 0, sizeof(eheap_stats));
-  eheap_update_stats();
-  eheap_unlock();
+  return (size + EHEAP_ALIGNMENT - 1) & ~(EHEAP_ALIGNMENT - 1);
 }
 
+#if EHEAP_USE_OPSTATS
 /*******************************************************************************
- ** \brief  Allocate memory
+ ** \brief  Read cycle counter (platform specific)
  ** \param  None
+ ** \retval Timestamp counter value
+ ******************************************************************************/
+static uint64_t eheap_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t value;
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  struct timespec ts; // Fallback, nanoseconds instead of cycles
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Account finished operation
+ ** \param  op - operation counters, start - cycles at entry, nodes - node
+ **         counter at entry
  ** \retval None
  ******************************************************************************/
-void* eheap_alloc(size_t size)
+static void eheap_op_record(eheap_op_stats_t* op, uint64_t start, size_t nodes)
+{
+  uint64_t cycles = eheap_cycles() - start;
+  nodes = eheap_op_nodes - nodes;
+  size_t bucket = cycles ? 63 - (size_t)__builtin_clzll(cycles) : 0;
+  if (bucket >= EHEAP_OPSTATS_BUCKETS) bucket = EHEAP_OPSTATS_BUCKETS - 1;
+  __atomic_fetch_add(&op->count, 1, __ATOMIC_RELAXED); // No heap lock, instrumented ops keep their timing
+  __atomic_fetch_add(&op->cycles_total, cycles, __ATOMIC_RELAXED);
+  EHEAP_ATOMIC_MAX(&op->cycles_max, cycles);
+  __atomic_fetch_add(&op->nodes_total, nodes, __ATOMIC_RELAXED);
+  EHEAP_ATOMIC_MAX(&op->nodes_max, nodes);
+  __atomic_fetch_add(&op->cycles_hist[bucket], 1, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+ ** \brief  Read operation counters field by field, optionally zeroing them
+ ** \param  dst - output, src - live counters, clear - reset src while reading
+ ** \retval None
+ ******************************************************************************/
+static void eheap_op_collect(eheap_op_stats_t* dst, eheap_op_stats_t* src, bool clear)
+{
+#define EHEAP_OP_TAKE(field) (dst->field = clear ? __atomic_exchange_n(&src->field, 0, __ATOMIC_RELAXED) \
+                                                 : __atomic_load_n(&src->field, __ATOMIC_RELAXED))
+  EHEAP_OP_TAKE(count);
+  EHEAP_OP_TAKE(cycles_max);
+  EHEAP_OP_TAKE(cycles_total);
+  EHEAP_OP_TAKE(nodes_max);
+  EHEAP_OP_TAKE(nodes_total);
+  for (size_t i = 0; i < EHEAP_OPSTATS_BUCKETS; i++) EHEAP_OP_TAKE(cycles_hist[i]);
+#undef EHEAP_OP_TAKE
+}
+#endif
+
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+/*******************************************************************************
+ ** \brief  Make active region one free block
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_format(void)
+{
+  eheap_free_block_t* first = (eheap_free_block_t*)eheap_mem;
+  first->size = eheap_mem_size;
+  eheap_free_head = &eheap_free_head_slot;
+  *eheap_free_head = 0;
+#if EHEAP_USE_TREE_INDEX
+  eheap_tree_size_root = 0;
+  eheap_tree_addr_root = 0;
+  eheap_tree_free_bytes = 0;
+  eheap_tree_free_count = 0;
+#endif
+  eheap_list_insert(eheap_free_head, first);
+}
+
+/*******************************************************************************
+ ** \brief  Insert free block into address ordered list at link and into size
+ **         index. Call with heap locked.
+ ** \param  link - list head or next field of preceding free block,
+ **         block - free block with size set
+ ** \retval None
+ ******************************************************************************/
+static void eheap_list_insert(eheap_link_t* link, eheap_free_block_t* block)
+{
+  eheap_free_block_t* next = eheap_link_get(link);
+  eheap_link_set(&block->next, next);
+  eheap_link_set(link, block);
+#if EHEAP_USE_TREE_INDEX
+  eheap_tree_insert(&eheap_tree_size_root, block, EHEAP_TREE_BY_SIZE);
+  eheap_tree_insert(&eheap_tree_addr_root, block, EHEAP_TREE_BY_ADDR);
+  eheap_tree_free_bytes += block->size;
+  eheap_tree_free_count++;
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Unlink free block from address ordered list and size index. Block
+ **         header stays intact. Call with heap locked.
+ ** \param  link - link pointing to block
+ ** \retval None
+ ******************************************************************************/
+static void eheap_list_remove(eheap_link_t* link)
+{
+  eheap_free_block_t* block = eheap_link_get(link);
+  eheap_free_block_t* next = eheap_link_get(&block->next);
+  eheap_link_set(link, next);
+#if EHEAP_USE_TREE_INDEX
+  eheap_tree_remove(block, EHEAP_TREE_BY_SIZE);
+  eheap_tree_remove(block, EHEAP_TREE_BY_ADDR);
+  eheap_tree_free_bytes -= block->size;
+  eheap_tree_free_count--;
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Give first cut bytes of free block to preceding allocated block.
+ **         Remainder keeps list position, and index node position where key
+ **         order allows, so growth at end of free block needs no rebalancing.
+ **         Call with heap locked.
+ ** \param  link - link pointing to free block, cut - bytes to take, remainder
+ **         must stay at least EHEAP_MIN_BLOCK
+ ** \retval None
+ ******************************************************************************/
+static void eheap_list_trim(eheap_link_t* link, size_t cut)
 {
-  if(size == 0 || size > EHEAP_SIZE - sizeof(eheap_free_block_t))
+  eheap_free_block_t* block = eheap_link_get(link);
+  eheap_free_block_t* next = eheap_link_get(&block->next);
+  eheap_free_block_t* moved = (eheap_free_block_t*)((uint8_t*)block + cut);
+  size_t size = block->size - cut;
+#if EHEAP_USE_TREE_INDEX
+  eheap_link_t* slots[2];
+  eheap_free_block_t* kids[2][2];
+  for (int tree = EHEAP_TREE_BY_SIZE; tree <= EHEAP_TREE_BY_ADDR; tree++) // Read old node before header moves over it
   {
-    eheap_stats.alloc_failures++;
-    return NULL;
+    if (eheap_tree_locate(block, moved, size, tree, &slots[tree]))
+    {
+      kids[tree][0] = eheap_link_get(&EHEAP_TREE_NODE(block)->child[tree][0]);
+      kids[tree][1] = eheap_link_get(&EHEAP_TREE_NODE(block)->child[tree][1]);
+    }
+    else
+    {
+      eheap_tree_remove(block, tree);
+      slots[tree] = NULL;
+    }
   }
-  eheap_lock();
-  eheap_stats.total_allocations++;
-  size = eheap_align_up(size);
-  size_t total_size = size + sizeof(eheap_free_block_t);
-  eheap_free_block_t** current = &eheap_free_list;
-  eheap_free_block_t** best_fit = NULL;
-  size_t best_fit_size = SIZE_MAX;
-  while (*current) // Best-fit algorithm
+  eheap_tree_free_bytes -= cut;
+#endif
+  moved->size = size;
+  eheap_link_set(&moved->next, next);
+  eheap_link_set(link, moved);
+#if EHEAP_USE_TREE_INDEX
+  for (int tree = EHEAP_TREE_BY_SIZE; tree <= EHEAP_TREE_BY_ADDR; tree++)
   {
-    if ((*current)->size >= total_size) 
+    if (!slots[tree])
     {
-      if ((*current)->size < best_fit_size) // Found potential block, check if it's better fit
-      {
-        best_fit = current;
-        best_fit_size = (*current)->size;
-      }
+      eheap_tree_insert(EHEAP_TREE_ROOT(tree), moved, tree);
+      continue;
     }
-    current = &(*current)->next;
+    eheap_link_set(&EHEAP_TREE_NODE(moved)->child[tree][0], kids[tree][0]);
+    eheap_link_set(&EHEAP_TREE_NODE(moved)->child[tree][1], kids[tree][1]);
+    eheap_link_set(slots[tree], moved);
   }
-  if (!best_fit) 
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Check size of allocated block header, block must hold tree node or
+ **         free header and end inside arena. Call with heap locked.
+ ** \param  block - block header inside arena
+ ** \retval true if size is sane
+ ******************************************************************************/
+static bool eheap_block_sane(eheap_free_block_t* block)
+{
+  return block->size >= EHEAP_MIN_BLOCK && block->size <= (size_t)(eheap_mem + eheap_mem_size - (uint8_t*)block);
+}
+
+/*******************************************************************************
+ ** \brief  Distance from block user area to user pointer with given alignment,
+ **         nonzero gap must be able to stay free block
+ ** \param  block - candidate free block, alignment - power of two alignment
+ ** \retval Leading gap in bytes
+ ******************************************************************************/
+static size_t eheap_align_gap(eheap_free_block_t* block, size_t alignment)
+{
+  uintptr_t user = ((uintptr_t)(block + 1) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+  size_t gap = user - (uintptr_t)(block + 1);
+  while (gap != 0 && gap < EHEAP_MIN_BLOCK) gap += alignment;
+  return gap;
+}
+
+/*******************************************************************************
+ ** \brief  Update heap statistics
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_update_stats(void)
+{
+#if EHEAP_USE_TREE_INDEX
+  size_t free_memory = eheap_tree_free_bytes;
+  size_t largest_block = 0;
+  size_t free_blocks_count = eheap_tree_free_count;
+  eheap_free_block_t* current = eheap_link_get(&eheap_tree_size_root);
+  while (current) // Largest size is rightmost tree node
   {
-    eheap_stats.alloc_failures++;
-    eheap_unlock();
-    return NULL;
+    EHEAP_NODE_VISIT();
+    largest_block = current->size;
+    current = eheap_link_get(&EHEAP_TREE_NODE(current)->child[EHEAP_TREE_BY_SIZE][1]);
   }
-  eheap_free_block_t* allocated = *best_fit;
-  if (allocated->size >= total_size + sizeof(eheap_free_block_t) + EHEAP_ALIGNMENT) // Check if we can split the block
-  {
-    eheap_free_block_t* new_free = (eheap_free_block_t*)((uint8_t*)allocated + total_size);
-    new_free->size = allocated->size - total_size;
-    new_free->next = allocated->next;
-    *best_fit = new_free;
-    allocated->size = total_size;
-  } 
-  else 
+#else
+  size_t free_memory = 0;
+  size_t largest_block = 0;
+  size_t free_blocks_count = 0;
+  eheap_free_block_t* current = eheap_link_get(eheap_free_head);
+  while (current) 
   {
-    *best_fit = allocated->next; // Use whole block
+    EHEAP_NODE_VISIT();
+    free_memory += current->size;
+    free_blocks_count++;
+    if (current->size > largest_block) largest_block = current->size;
+    current = eheap_link_get(&current->next);
   }
-  void* user_ptr = (void*)(allocated + 1);
-  memset(user_ptr, 0, size);
-  eheap_update_stats();
-  eheap_unlock();
-  return user_ptr;
+#endif
+  eheap_stats.current_usage = eheap_mem_size -free_memory;
+  eheap_stats.largest_free_block = largest_block;
+  if (eheap_stats.current_usage > eheap_stats.peak_usage) eheap_stats.peak_usage = eheap_stats.current_usage;
+  if (free_blocks_count > 1) eheap_stats.fragmentation = (free_blocks_count * 100) / (eheap_mem_size / sizeof(eheap_free_block_t));
+  else                       eheap_stats.fragmentation = 0;
+#if EHEAP_USE_PRESSURE
+  eheap_watermark_update();
+#endif
 }
 
+#if EHEAP_USE_TREE_INDEX
 /*******************************************************************************
- ** \brief  Allocate and zero-initialize memory
- ** \param  None
+ ** \brief  Treap priority of block. Derived from end address, so both indexes
+ **         need no extra field and block trimmed from front keeps priority.
+ ** \param  block - free block
+ ** \retval Priority, larger is closer to root
+ ******************************************************************************/
+static uint32_t eheap_tree_priority(eheap_free_block_t* block)
+{
+  return (uint32_t)(((uint64_t)((uintptr_t)block + block->size) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+/*******************************************************************************
+ ** \brief  Key order of index, size index orders by (size, address) so that
+ **         equal sizes are taken lowest address first as by list best-fit
+ ** \param  a_size, a, b_size, b - sizes and addresses of two keys,
+ **         tree - EHEAP_TREE_BY_SIZE or EHEAP_TREE_BY_ADDR
+ ** \retval true if key a is below key b
+ ******************************************************************************/
+static bool eheap_tree_key_less(size_t a_size, void* a, size_t b_size, void* b, int tree)
+{
+  if (tree == EHEAP_TREE_BY_SIZE && a_size != b_size) return a_size < b_size;
+  return (uint8_t*)a < (uint8_t*)b;
+}
+
+static bool eheap_tree_less(eheap_free_block_t* a, eheap_free_block_t* b, int tree)
+{
+  return eheap_tree_key_less(a->size, a, b->size, b, tree);
+}
+
+/*******************************************************************************
+ ** \brief  Rotate subtree so that its child on given side becomes its root
+ ** \param  slot - link to subtree root, tree - index, side - 0 left, 1 right
  ** \retval None
  ******************************************************************************/
-void* eheap_calloc(size_t num, size_t size)
+static void eheap_tree_rotate(eheap_link_t* slot, int tree, int side)
 {
-  size_t total_size = num * size;
-  void* ptr = eheap_alloc(total_size);
-  if (ptr) memset(ptr, 0, total_size);
-  return ptr;
+  eheap_tree_node_t* top = EHEAP_TREE_NODE(eheap_link_get(slot));
+  eheap_tree_node_t* child = EHEAP_TREE_NODE(eheap_link_get(&top->child[tree][side]));
+  eheap_link_set(&top->child[tree][side], eheap_link_get(&child->child[tree][!side]));
+  eheap_link_set(&child->child[tree][!side], &top->hdr);
+  eheap_link_set(slot, &child->hdr);
 }
 
 /*******************************************************************************
- ** \brief  Reallocate memory
- ** \param  None
+ ** \brief  Insert free block into index treap
+ ** \param  slot - link to subtree root, block - free block, tree - index
  ** \retval None
  ******************************************************************************/
-void* eheap_realloc(void* ptr, size_t new_size)
+static void eheap_tree_insert(eheap_link_t* slot, eheap_free_block_t* block, int tree)
 {
-  if (!ptr) return eheap_alloc(new_size);
-  if (new_size == 0) { eheap_free(ptr); return NULL;}
-  if (!eheap_validate_ptr(ptr)) return NULL;
-  eheap_lock();
-  eheap_free_block_t* old_block = ((eheap_free_block_t*)ptr) - 1;
-  size_t old_size = old_block->size - sizeof(eheap_free_block_t);
-  if (new_size <= old_size){ eheap_unlock(); return ptr; }
-  uint8_t* block_end = (uint8_t*)old_block + old_block->size;
-  eheap_free_block_t* next_block = (eheap_free_block_t*)block_end;
-  if (block_end < (uint8_t*)eheap + EHEAP_SIZE && (uint8_t*)next_block < (uint8_t*)eheap + EHEAP_SIZE) 
+  eheap_free_block_t* top = eheap_link_get(slot);
+  if (!top)
   {
-    eheap_free_block_t* current = eheap_free_list;
-    while (current) 
-    {
-      if (current == next_block) 
-      {
-        size_t required_additional = eheap_align_up(new_size) - old_size;
-        if (current->size >= required_additional) // Expand into next free block
-        {
-          old_block->size += required_additional;
-          current->size -= required_additional;
-          if (current->size < sizeof(eheap_free_block_t) + EHEAP_ALIGNMENT) 
-          {
-            old_block->size += current->size; // Take the whole remaining block
-            eheap_free_block_t** prev = &eheap_free_list; // Remove current from free list
-            while (*prev != current) 
-            {
-              prev = &(*prev)->next;
-            }
-            *prev = current->next;
-          }
-          eheap_update_stats();
-          eheap_unlock();
-          return ptr;
-        }
-        break;
-      }
-      current = current->next;
-    }
+    eheap_tree_node_t* node = EHEAP_TREE_NODE(block);
+    node->child[tree][0] = 0;
+    node->child[tree][1] = 0;
+    eheap_link_set(slot, block);
+    return;
   }
-  eheap_unlock();
-  void* new_ptr = eheap_alloc(new_size);
-  if (new_ptr) 
+  EHEAP_NODE_VISIT();
+  int side = eheap_tree_less(top, block, tree);
+  eheap_link_t* child = &EHEAP_TREE_NODE(top)->child[tree][side];
+  eheap_tree_insert(child, block, tree);
+  if (eheap_tree_priority(eheap_link_get(child)) > eheap_tree_priority(top)) eheap_tree_rotate(slot, tree, side);
+}
+
+/*******************************************************************************
+ ** \brief  Remove free block from index treap
+ ** \param  block - indexed free block, tree - index
+ ** \retval None
+ ******************************************************************************/
+static void eheap_tree_remove(eheap_free_block_t* block, int tree)
+{
+  eheap_tree_node_t* node = EHEAP_TREE_NODE(block);
+  eheap_link_t* slot = EHEAP_TREE_ROOT(tree);
+  eheap_free_block_t* top;
+  while ((top = eheap_link_get(slot)) != block)
   {
-    memcpy(new_ptr, ptr, old_size);
-    eheap_free(ptr);
+    EHEAP_NODE_VISIT();
+    slot = &EHEAP_TREE_NODE(top)->child[tree][eheap_tree_less(top, block, tree)];
   }
-  return new_ptr;
+  while (node->child[tree][0] || node->child[tree][1]) // Rotate node down to leaf
+  {
+    EHEAP_NODE_VISIT();
+    eheap_free_block_t* left = eheap_link_get(&node->child[tree][0]);
+    eheap_free_block_t* right = eheap_link_get(&node->child[tree][1]);
+    int side = !left || (right && eheap_tree_priority(right) > eheap_tree_priority(left));
+    eheap_tree_rotate(slot, tree, side);
+    slot = &EHEAP_TREE_NODE(eheap_link_get(slot))->child[tree][!side];
+  }
+  eheap_link_set(slot, NULL);
 }
 
 /*******************************************************************************
- ** \brief  Free memory
- ** \param  None
- ** \retval None
+ ** \brief  Find smallest free block of at least size bytes, lowest address
+ **         among blocks of that size
+ ** \param  size - required block size including header
+ ** \retval Free block or NULL
  ******************************************************************************/
-void eheap_free(void* ptr)
+static eheap_free_block_t* eheap_tree_find(size_t size)
 {
-  if (!ptr || !eheap_validate_ptr(ptr)) return;
-  eheap_lock();
-  eheap_stats.total_frees++;
-  eheap_free_block_t* block = ((eheap_free_block_t*)ptr) - 1;
-  eheap_free_block_t* current = eheap_free_list;
-  while (current) 
+  eheap_free_block_t* best = NULL;
+  eheap_free_block_t* top = eheap_link_get(&eheap_tree_size_root);
+  while (top)
   {
-    if (current == block) 
-    {
-      eheap_unlock();
-      return; 
-    }
-    current = current->next;
+    EHEAP_NODE_VISIT();
+    int larger = top->size < size;
+    if (!larger) best = top;
+    top = eheap_link_get(&EHEAP_TREE_NODE(top)->child[EHEAP_TREE_BY_SIZE][larger]);
   }
+  return best;
+}
 
-  if (block->size < sizeof(eheap_free_block_t) || block->size > EHEAP_SIZE) 
+/*******************************************************************************
+ ** \brief  Find free block with highest address below ptr
+ ** \param  ptr - any address
+ ** \retval Free block or NULL
+ ******************************************************************************/
+static eheap_free_block_t* eheap_tree_floor(void* ptr)
+{
+  eheap_free_block_t* best = NULL;
+  eheap_free_block_t* top = eheap_link_get(&eheap_tree_addr_root);
+  while (top)
   {
-    eheap_unlock();
-    return;
+    EHEAP_NODE_VISIT();
+    int higher = (void*)top < ptr;
+    if (higher) best = top;
+    top = eheap_link_get(&EHEAP_TREE_NODE(top)->child[EHEAP_TREE_BY_ADDR][higher]);
   }
-  eheap_free_block_t** current_ptr = &eheap_free_list;
-  while (*current_ptr && *current_ptr < block) 
+  return best;
+}
+
+/*******************************************************************************
+ ** \brief  Find link to indexed block and check that key of trimmed block
+ **         still lies between keys of its in-order neighbours
+ ** \param  block - indexed free block, moved/size - address and size after
+ **         trim, tree - index, slot - output link to block
+ ** \retval true if trimmed block may take node position of block
+ ******************************************************************************/
+static bool eheap_tree_locate(eheap_free_block_t* block, eheap_free_block_t* moved, size_t size, int tree, eheap_link_t** slot)
+{
+  eheap_free_block_t* low = NULL;
+  eheap_free_block_t* high = NULL;
+  eheap_free_block_t* top;
+  *slot = EHEAP_TREE_ROOT(tree);
+  while ((top = eheap_link_get(*slot)) != block)
   {
-    current_ptr = &(*current_ptr)->next;
+    EHEAP_NODE_VISIT();
+    int side = eheap_tree_less(top, block, tree);
+    if (side) low = top;
+    else      high = top;
+    *slot = &EHEAP_TREE_NODE(top)->child[tree][side];
   }
-  block->next = *current_ptr;
-  *current_ptr = block;
-  eheap_defragment();
-  eheap_update_stats();
-  eheap_unlock();
+  for (top = eheap_link_get(&EHEAP_TREE_NODE(block)->child[tree][0]); top; top = eheap_link_get(&EHEAP_TREE_NODE(top)->child[tree][1])) low = top;
+  for (top = eheap_link_get(&EHEAP_TREE_NODE(block)->child[tree][1]); top; top = eheap_link_get(&EHEAP_TREE_NODE(top)->child[tree][0])) high = top;
+  return (!low || eheap_tree_key_less(low->size, low, size, moved, tree)) &&
+         (!high || eheap_tree_key_less(size, moved, high->size, high, tree));
+}
+
+/*******************************************************************************
+ ** \brief  Link pointing to free block in address ordered list
+ ** \param  block - free block
+ ** \retval List head or next field of preceding free block
+ ******************************************************************************/
+static eheap_link_t* eheap_list_slot(eheap_free_block_t* block)
+{
+  eheap_free_block_t* prev = eheap_tree_floor(block);
+  return prev ? &prev->next : eheap_free_head;
 }
 
+#if EHEAP_USE_PERSIST
 /*******************************************************************************
- ** \brief  Get heap statistics
+ ** \brief  Rebuild size and address index from address ordered list
  ** \param  None
  ** \retval None
  ******************************************************************************/
-void eheap_get_stats(eheap_stats_t* stats)
+static void eheap_tree_rebuild(void)
 {
-  if (!stats) return;
-  eheap_lock();
-  memcpy(stats, &eheap_stats, sizeof(eheap_stats));
-  eheap_unlock();
+  eheap_tree_size_root = 0;
+  eheap_tree_addr_root = 0;
+  eheap_tree_free_bytes = 0;
+  eheap_tree_free_count = 0;
+  eheap_free_block_t* block = eheap_link_get(eheap_free_head);
+  while (block)
+  {
+    eheap_tree_insert(&eheap_tree_size_root, block, EHEAP_TREE_BY_SIZE);
+    eheap_tree_insert(&eheap_tree_addr_root, block, EHEAP_TREE_BY_ADDR);
+    eheap_tree_free_bytes += block->size;
+    eheap_tree_free_count++;
+    block = eheap_link_get(&block->next);
+  }
 }
+#endif
 
 /*******************************************************************************
- ** \brief  Get heap usage percentage (0-100)
+ ** \brief  Check key ordering and heap order of subtree
+ ** \param  top - subtree root, tree - index, low/high - exclusive key bounds
+ **         (NULL - none), count - incremented by number of indexed blocks
+ ** \retval true if subtree is consistent
+ ******************************************************************************/
+static bool eheap_tree_check(eheap_free_block_t* top, int tree, eheap_free_block_t* low, eheap_free_block_t* high, size_t* count)
+{
+  if (!top) return true;
+  if (!eheap_in_arena(top) || (low && !eheap_tree_less(low, top, tree)) || (high && !eheap_tree_less(top, high, tree))) return false;
+  if (++(*count) > eheap_tree_free_count) return false; // Cycle
+  eheap_free_block_t* left = eheap_link_get(&EHEAP_TREE_NODE(top)->child[tree][0]);
+  eheap_free_block_t* right = eheap_link_get(&EHEAP_TREE_NODE(top)->child[tree][1]);
+  if ((left && eheap_tree_priority(left) > eheap_tree_priority(top)) || (right && eheap_tree_priority(right) > eheap_tree_priority(top))) return false;
+  return eheap_tree_check(left, tree, low, top, count) && eheap_tree_check(right, tree, top, high, count);
+}
+#endif
+#endif
+
+/*******************************************************************************
+ ** \brief  Validate pointer before freeing
  ** \param  None
  ** \retval None
  ******************************************************************************/
-size_t eheap_get_usage_percent(void)
+bool eheap_validate_ptr(void* ptr)
 {
+  if(!ptr) return false;
+  if(((uintptr_t)ptr & (EHEAP_ALIGNMENT - 1)) != 0) return false; // Check alignment
+  if(eheap_in_arena(ptr)) return true;
+#if EHEAP_USE_MMAP_LARGE
   eheap_lock();
-  size_t percent = (eheap_stats.current_usage *100) /EHEAP_SIZE;
+  bool mapped = eheap_mmap_find(ptr) != NULL;
   eheap_unlock();
-  return percent;
+  return mapped;
+#else
+  return false;
+#endif
 }
 
 /*******************************************************************************
- ** \brief  Check if heap is valid (debug function)
- ** \param  None
- ** \retval None
+ ** \brief  Check if pointer is within heap arena bounds
+ ** \param  ptr - pointer to check
+ ** \retval true if inside arena
  ******************************************************************************/
-bool eheap_validate(void)
+static bool eheap_in_arena(void* ptr)
 {
-  eheap_lock();
-  bool valid = true;
+  uint8_t* test_ptr = (uint8_t*)ptr;
+  return test_ptr >= eheap_mem && test_ptr < eheap_mem + eheap_mem_size;
+}
+
+/*******************************************************************************
+ ** \brief  Check pointer passed with known size: aligned and header inside
+ **         arena. Header contents are checked later with heap locked.
+ ** \param  ptr - user pointer
+ ** \retval true if pointer may belong to arena block
+ ******************************************************************************/
+static bool eheap_arena_user_ptr(void* ptr)
+{
+  return ((uintptr_t)ptr & (EHEAP_ALIGNMENT - 1)) == 0 && eheap_in_arena((eheap_free_block_t*)ptr - 1);
+}
+
+#if EHEAP_USE_MMAP_LARGE
+/*******************************************************************************
+ ** \brief  Round size up to page size
+ ** \param  size - size in bytes
+ ** \retval Rounded size
+ ******************************************************************************/
+static size_t eheap_page_round(size_t size)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  return (size + page - 1) & ~(page - 1);
+}
+
+/*******************************************************************************
+ ** \brief  Find mapped region by user pointer, call with heap locked. Region
+ **         being resized is owned by resizing thread and not found.
+ ** \param  ptr - user pointer
+ ** \retval Side table entry or NULL
+ ******************************************************************************/
+static eheap_mmap_region_t* eheap_mmap_find(void* ptr)
+{
+  if (eheap_stats.mapped_regions == 0) return NULL;
+  for (size_t i = 0; i < EHEAP_MMAP_MAX_REGIONS; i++)
+  {
+    EHEAP_NODE_VISIT();
+    eheap_mmap_region_t* region = &eheap_mmap_regions[i];
+    if (region->base && !region->busy && region->base + region->offset == (uint8_t*)ptr) return region;
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ ** \brief  Serve large request from dedicated mapping. Block keeps regular
+ **         header in front of user pointer, so size and profiler tag work as
+ **         for arena blocks.
+ ** \param  size - requested size, alignment - user pointer alignment
+ ** \retval User pointer or NULL if mapping or side table slot is unavailable
+ ******************************************************************************/
+static void* eheap_mmap_alloc(size_t size, size_t alignment)
+{
+#if EHEAP_USE_PERSIST
+  if (eheap_persist_hdr) return NULL; // Mapped blocks would not survive restart
+#endif
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t offset = alignment > sizeof(eheap_free_block_t) ? alignment : sizeof(eheap_free_block_t);
+  if (offset > page || size > SIZE_MAX - offset - page) return NULL;
+  size_t length = eheap_page_round(offset + size);
+  uint8_t* base = (uint8_t*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) return NULL;
+  eheap_lock();
+  eheap_mmap_region_t* region = NULL;
+  for (size_t i = 0; i < EHEAP_MMAP_MAX_REGIONS && !region; i++)
+  {
+    EHEAP_NODE_VISIT();
+    if (!eheap_mmap_regions[i].base) region = &eheap_mmap_regions[i];
+  }
+  if (!region)
+  {
+    eheap_unlock();
+    munmap(base, length);
+    return NULL;
+  }
+  region->base = base;
+  region->length = length;
+  region->offset = offset;
+  region->busy = false;
+  eheap_free_block_t* block = (eheap_free_block_t*)(base + offset) - 1;
+  block->size = length - offset + sizeof(eheap_free_block_t);
+  block->next = 0;
+  eheap_stats.total_allocations++;
+  eheap_stats.mapped_regions++;
+  eheap_stats.mapped_usage += length;
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (eheap_prof_on_alloc(block + 1, size, eheap_prof_caller)) block->next = EHEAP_PROF_TAG;
+#endif
+  return block + 1;
+}
+
+/*******************************************************************************
+ ** \brief  Resize mapped block, pages are moved by mremap instead of copied.
+ **         Slot is marked busy and mapping is moved with heap unlocked, so
+ **         other threads are not held up by page remapping or copying.
+ ** \param  ptr - user pointer of mapped block, new_size - requested size
+ ** \retval New user pointer or NULL
+ ******************************************************************************/
+static void* eheap_mmap_realloc(void* ptr, size_t new_size)
+{
+  eheap_lock();
+  eheap_mmap_region_t* region = eheap_mmap_find(ptr);
+  if (!region || new_size > SIZE_MAX - region->offset - (size_t)sysconf(_SC_PAGESIZE))
+  {
+    eheap_unlock();
+    return NULL;
+  }
+  size_t length = eheap_page_round(region->offset + new_size);
+  if (length == region->length)
+  {
+    eheap_unlock();
+    return ptr;
+  }
+  uint8_t* old_base = region->base;
+  size_t old_length = region->length;
+  size_t offset = region->offset;
+  region->busy = true; // Keep slot and stats, block is owned by this call
+  eheap_unlock();
+#ifdef MREMAP_MAYMOVE
+  uint8_t* base = (uint8_t*)mremap(old_base, old_length, length, MREMAP_MAYMOVE);
+#else
+  uint8_t* base = (uint8_t*)mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base != MAP_FAILED)
+  {
+    memcpy(base, old_base, length < old_length ? length : old_length);
+    munmap(old_base, old_length);
+  }
+#endif
+  eheap_lock();
+  region->busy = false;
+  if (base == MAP_FAILED)
+  {
+    eheap_unlock();
+    return NULL;
+  }
+  eheap_stats.mapped_usage = eheap_stats.mapped_usage - old_length + length;
+  region->base = base;
+  region->length = length;
+  eheap_free_block_t* block = (eheap_free_block_t*)(base + offset) - 1;
+  block->size = length - offset + sizeof(eheap_free_block_t);
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (block->next == EHEAP_PROF_TAG) eheap_prof_on_resize(ptr, block + 1, new_size);
+#endif
+  return block + 1;
+}
+
+/*******************************************************************************
+ ** \brief  Unmap mapped block
+ ** \param  ptr - user pointer
+ ** \retval true if pointer was a mapped block
+ ******************************************************************************/
+static bool eheap_mmap_free(void* ptr)
+{
+  eheap_lock();
+  eheap_mmap_region_t* region = eheap_mmap_find(ptr);
+  if (!region)
+  {
+    eheap_unlock();
+    return false;
+  }
+  uint8_t* base = region->base;
+  size_t length = region->length;
+#if EHEAP_USE_PROFILER
+  bool sampled = (((eheap_free_block_t*)ptr - 1)->next == EHEAP_PROF_TAG);
+#endif
+  region->base = NULL;
+  eheap_stats.total_frees++;
+  eheap_stats.mapped_regions--;
+  eheap_stats.mapped_usage -= length;
+  eheap_unlock();
+  munmap(base, length);
+#if EHEAP_USE_PROFILER
+  if (sampled) eheap_prof_on_free(ptr);
+#endif
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Unmap all mapped blocks on heap reinitialization, call with heap
+ **         locked
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_mmap_release_all(void)
+{
+  for (size_t i = 0; i < EHEAP_MMAP_MAX_REGIONS; i++)
+  {
+    if (!eheap_mmap_regions[i].base) continue;
+    munmap(eheap_mmap_regions[i].base, eheap_mmap_regions[i].length);
+    eheap_mmap_regions[i].base = NULL;
+  }
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  Initialize heap
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+void eheap_init(void)
+{
+  eheap_init_mutex();
+  eheap_lock();
+#if EHEAP_USE_MMAP_LARGE
+  eheap_mmap_release_all();
+#endif
+  memset(eheap, 0, EHEAP_SIZE);
+  eheap_mem = eheap;
+  eheap_mem_size = EHEAP_SIZE;
+  eheap_format();
+  memset(&eheap_stats, 0, sizeof(eheap_stats));
+#if EHEAP_USE_PRESSURE
+  eheap_watermark_above = false;
+#endif
+#if EHEAP_USE_FASTPATH
+  __atomic_store_n(&eheap_fast_generation, eheap_fast_generation + 1, __ATOMIC_RELAXED); // Cached blocks of all threads belong to old heap
+#endif
+  eheap_update_stats();
+  eheap_unlock();
+}
+
+/*******************************************************************************
+ ** \brief  Initialize heap over caller provided region instead of static array.
+ **         Region is not cleared, so untouched pages of fresh mapping stay
+ **         uncommitted.
+ ** \param  region - start of memory region, size - region size in bytes
+ ** \retval true on success, false if region is too small
+ ******************************************************************************/
+bool eheap_init_region(void* region, size_t size)
+{
+  if (!region) return false;
+  uintptr_t start = ((uintptr_t)region + EHEAP_ALIGNMENT - 1) & ~(uintptr_t)(EHEAP_ALIGNMENT - 1);
+  size_t skip = start - (uintptr_t)region;
+  if (size < skip) return false;
+  size = (size - skip) & ~(size_t)(EHEAP_ALIGNMENT - 1);
+  if (size < EHEAP_MIN_BLOCK) return false;
+  eheap_init_mutex();
+  eheap_lock();
+#if EHEAP_USE_MMAP_LARGE
+  eheap_mmap_release_all();
+#endif
+  eheap_mem = (uint8_t*)start;
+  eheap_mem_size = size;
+  eheap_format();
+  memset(&eheap_stats, 0, sizeof(eheap_stats));
+#if EHEAP_USE_PRESSURE
+  eheap_watermark_above = false;
+#endif
+#if EHEAP_USE_FASTPATH
+  __atomic_store_n(&eheap_fast_generation, eheap_fast_generation + 1, __ATOMIC_RELAXED); // Cached blocks of all threads belong to old heap
+#endif
+  eheap_update_stats();
+  eheap_unlock();
+  return true;
+}
+
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+/*******************************************************************************
+ ** \brief  Check arena request, lock heap and count it. Heap stays locked
+ **         when true is returned.
+ ** \param  size - requested size, total_size - output block size with header
+ ** \retval true if fit may be searched
+ ******************************************************************************/
+static bool eheap_alloc_begin(size_t size, size_t* total_size)
+{
+  if(size == 0 || size > eheap_mem_size - sizeof(eheap_free_block_t))
+  {
+    eheap_count_failure();
+    return false;
+  }
+  eheap_lock();
+  eheap_stats.total_allocations++;
+  *total_size = eheap_align_up(size) + sizeof(eheap_free_block_t);
+  if (*total_size < EHEAP_MIN_BLOCK) *total_size = EHEAP_MIN_BLOCK;
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Carve allocated block out of chosen free block and finish
+ **         request: leading gap and trailing rest stay free, user area is
+ **         zeroed and heap is unlocked. Call with heap locked.
+ ** \param  fit - link to chosen free block or NULL if none fits,
+ **         gap - bytes kept free in front, 0 or at least EHEAP_MIN_BLOCK,
+ **         total_size - block size with header, size - requested size
+ ** \retval User pointer or NULL
+ ******************************************************************************/
+static void* eheap_alloc_finish(eheap_link_t* fit, size_t gap, size_t total_size, size_t size)
+{
+  if (!fit)
+  {
+    eheap_stats.alloc_failures++;
+    EHEAP_FIT_FAILED(true);
+    eheap_unlock();
+    return NULL;
+  }
+  eheap_free_block_t* block = eheap_link_get(fit);
+  eheap_free_block_t* allocated = (eheap_free_block_t*)((uint8_t*)block + gap);
+  size_t rest = block->size - gap - total_size;
+  if (rest < EHEAP_MIN_BLOCK) // Too small to stay free, take it too
+  {
+    total_size += rest;
+    rest = 0;
+  }
+  if (gap) // Keep leading gap as free block
+  {
+    eheap_list_remove(fit);
+    block->size = gap;
+    eheap_list_insert(fit, block);
+    if (rest)
+    {
+      eheap_free_block_t* new_free = (eheap_free_block_t*)((uint8_t*)allocated + total_size);
+      new_free->size = rest;
+      eheap_list_insert(&block->next, new_free);
+    }
+  }
+  else if (rest)
+  {
+    eheap_list_trim(fit, total_size);
+  }
+  else
+  {
+    eheap_list_remove(fit);
+  }
+  allocated->size = total_size;
+  allocated->next = 0;
+  void* user_ptr = (void*)(allocated + 1);
+  memset(user_ptr, 0, eheap_align_up(size));
+  eheap_update_stats();
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (eheap_prof_on_alloc(user_ptr, size, eheap_prof_caller)) allocated->next = EHEAP_PROF_TAG;
+#endif
+  return user_ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void* eheap_do_alloc(size_t size)
+{
+  EHEAP_FIT_FAILED(false);
+#if EHEAP_USE_MMAP_LARGE
+  if (size >= EHEAP_MMAP_THRESHOLD)
+  {
+    void* mapped = eheap_mmap_alloc(size, EHEAP_ALIGNMENT);
+    if (mapped) return mapped; // Otherwise try arena
+  }
+#endif
+  size_t total_size;
+  if (!eheap_alloc_begin(size, &total_size)) return NULL;
+  eheap_link_t* best_fit = NULL;
+#if EHEAP_USE_TREE_INDEX
+  eheap_free_block_t* found = eheap_tree_find(total_size);
+  if (found) best_fit = eheap_list_slot(found);
+#else
+  eheap_link_t* current = eheap_free_head;
+  size_t best_fit_size = SIZE_MAX;
+  eheap_free_block_t* block;
+  while ((block = eheap_link_get(current)) != NULL) // Best-fit algorithm
+  {
+    EHEAP_NODE_VISIT();
+    if (block->size >= total_size) 
+    {
+      if (block->size < best_fit_size) // Found potential block, check if it's better fit
+      {
+        best_fit = current;
+        best_fit_size = block->size;
+      }
+    }
+    current = &block->next;
+  }
+#endif
+  return eheap_alloc_finish(best_fit, 0, total_size, size);
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory with user pointer aligned to power of two alignment
+ ** \param  alignment - required alignment, size - requested size
+ ** \retval Pointer to aligned memory or NULL
+ ******************************************************************************/
+static void* eheap_do_alloc_aligned(size_t alignment, size_t size)
+{
+  if (alignment <= EHEAP_ALIGNMENT) return eheap_do_alloc(size);
+  EHEAP_FIT_FAILED(false);
+#if EHEAP_USE_MMAP_LARGE
+  if (size >= EHEAP_MMAP_THRESHOLD && (alignment & (alignment - 1)) == 0)
+  {
+    void* mapped = eheap_mmap_alloc(size, alignment);
+    if (mapped) return mapped;
+  }
+#endif
+  if ((alignment & (alignment - 1)) != 0)
+  {
+    eheap_count_failure();
+    return NULL;
+  }
+  size_t total_size;
+  if (!eheap_alloc_begin(size, &total_size)) return NULL;
+  eheap_link_t* best_fit = NULL;
+  size_t best_fit_gap = 0;
+  eheap_free_block_t* block;
+#if EHEAP_USE_TREE_INDEX
+  block = eheap_tree_find(total_size + alignment + EHEAP_MIN_BLOCK); // Fits whatever its address is
+  if (block)
+  {
+    best_fit = eheap_list_slot(block);
+    best_fit_gap = eheap_align_gap(block, alignment);
+  }
+  else // Smaller block may still fit at suitable address
+#endif
+  {
+    eheap_link_t* current = eheap_free_head;
+    size_t best_fit_size = SIZE_MAX;
+    while ((block = eheap_link_get(current)) != NULL) // Best-fit over blocks that can hold aligned user pointer
+    {
+      EHEAP_NODE_VISIT();
+      size_t gap = eheap_align_gap(block, alignment);
+      if (block->size >= gap + total_size && block->size < best_fit_size)
+      {
+        best_fit = current;
+        best_fit_size = block->size;
+        best_fit_gap = gap;
+      }
+      current = &block->next;
+    }
+  }
+  return eheap_alloc_finish(best_fit, best_fit_gap, total_size, size);
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory placed by expected lifetime. Long-lived blocks take
+ **         lowest address block that fits, short-lived blocks the highest one
+ **         and are carved from its top, so both kinds grow from opposite ends
+ **         and short-lived churn leaves holes next to each other.
+ ** \param  size - requested size, flags - EHEAP_HINT_* flags
+ ** \retval Pointer or NULL
+ ******************************************************************************/
+static void* eheap_do_alloc_hint(size_t size, unsigned int flags)
+{
+  bool high = (flags & EHEAP_HINT_SHORT_LIVED) != 0;
+  if (!high && !(flags & EHEAP_HINT_LONG_LIVED)) return eheap_do_alloc(size);
+#if EHEAP_USE_MMAP_LARGE
+  if (size >= EHEAP_MMAP_THRESHOLD) return eheap_do_alloc(size); // Mapped blocks have no placement
+#endif
+  EHEAP_FIT_FAILED(false);
+  size_t total_size;
+  if (!eheap_alloc_begin(size, &total_size)) return NULL;
+  eheap_link_t* fit = NULL;
+  eheap_link_t* current = eheap_free_head;
+  eheap_free_block_t* block;
+  while ((block = eheap_link_get(current)) != NULL) // Address order, first or last fit
+  {
+    EHEAP_NODE_VISIT();
+    if (block->size >= total_size)
+    {
+      fit = current;
+      if (!high) break;
+    }
+    current = &block->next;
+  }
+  size_t gap = 0;
+  if (high && fit && (block = eheap_link_get(fit))->size >= total_size + EHEAP_MIN_BLOCK) gap = block->size - total_size; // Carve from top
+  return eheap_alloc_finish(fit, gap, total_size, size);
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  Allocate and zero-initialize memory
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+void* eheap_calloc(size_t num, size_t size)
+{
+  if (size && num > SIZE_MAX / size) // Multiplication overflow
+  {
+    eheap_count_failure();
+    return NULL;
+  }
+  size_t total_size = num * size;
+  EHEAP_PROF_ENTER();
+  void* ptr = eheap_alloc(total_size);
+  EHEAP_PROF_LEAVE();
+  if (ptr) memset(ptr, 0, total_size);
+  return ptr;
+}
+
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+/*******************************************************************************
+ ** \brief  Reallocate memory
+ ** \param  ptr - block to resize, old_size_hint - size caller last requested
+ **         for ptr or 0 if unknown, new_size - requested size
+ ** \retval Resized block or NULL
+ ******************************************************************************/
+static void* eheap_do_realloc(void* ptr, size_t old_size_hint, size_t new_size)
+{
+  if (!ptr) return eheap_alloc(new_size);
+  if (new_size == 0) { old_size_hint ? eheap_free_sized(ptr, old_size_hint) : eheap_free(ptr); return NULL;}
+#if EHEAP_USE_MMAP_LARGE
+  if (!eheap_in_arena(ptr)) return eheap_mmap_realloc(ptr, new_size);
+#endif
+  if (old_size_hint ? !eheap_arena_user_ptr(ptr) : !eheap_validate_ptr(ptr)) return NULL; // Known size skips only mapped lookup
+  eheap_lock();
+  eheap_free_block_t* old_block = ((eheap_free_block_t*)ptr) - 1;
+  if (!eheap_block_sane(old_block))
+  {
+    eheap_unlock();
+    return NULL;
+  }
+  size_t old_size = old_block->size - sizeof(eheap_free_block_t);
+  if (new_size <= old_size){ eheap_unlock(); return ptr; }
+  uint8_t* block_end = (uint8_t*)old_block + old_block->size;
+  eheap_free_block_t* next_block = (eheap_free_block_t*)block_end;
+  if (block_end < eheap_mem + eheap_mem_size && (uint8_t*)next_block < eheap_mem + eheap_mem_size) 
+  {
+#if EHEAP_USE_TREE_INDEX
+    eheap_link_t* link = eheap_list_slot(next_block); // Preceding free block from address index
+#else
+    eheap_link_t* link = eheap_free_head;
+    while (*link && eheap_link_get(link) < next_block)
+    {
+      EHEAP_NODE_VISIT();
+      link = &eheap_link_get(link)->next;
+    }
+#endif
+    if (eheap_link_get(link) == next_block)
+    {
+      size_t required_additional = eheap_align_up(new_size) - old_size;
+      size_t next_size = next_block->size;
+      if (next_size >= required_additional) // Expand into next free block
+      {
+        if (next_size - required_additional < EHEAP_MIN_BLOCK)
+        {
+          eheap_list_remove(link);
+          old_block->size += next_size; // Take the whole remaining block
+        }
+        else
+        {
+          eheap_list_trim(link, required_additional); // Move free block header past grown block
+          old_block->size += required_additional;
+        }
+        eheap_update_stats();
+        eheap_unlock();
+#if EHEAP_USE_PROFILER
+        if (old_block->next == EHEAP_PROF_TAG) eheap_prof_on_resize(ptr, ptr, new_size);
+#endif
+        return ptr;
+      }
+    }
+  }
+  eheap_unlock();
+  void* new_ptr = eheap_alloc(new_size);
+  if (new_ptr) 
+  {
+    if (old_size_hint)
+    {
+      memcpy(new_ptr, ptr, old_size_hint < old_size ? old_size_hint : old_size); // Copy only live bytes
+      eheap_free_sized(ptr, old_size_hint);
+    }
+    else
+    {
+      memcpy(new_ptr, ptr, old_size);
+      eheap_free(ptr);
+    }
+  }
+  return new_ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Free memory
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_do_free(void* ptr)
+{
+#if EHEAP_USE_MMAP_LARGE
+  if (ptr && !eheap_in_arena(ptr) && eheap_mmap_free(ptr)) return;
+#endif
+  if (!ptr || !eheap_validate_ptr(ptr)) return;
+  eheap_lock();
+  eheap_stats.total_frees++;
+  eheap_free_block_t* block = ((eheap_free_block_t*)ptr) - 1;
+  if (!eheap_block_sane(block))
+  {
+    eheap_unlock();
+    return;
+  }
+#if EHEAP_USE_PROFILER
+  bool sampled = (block->next == EHEAP_PROF_TAG);
+#endif
+  eheap_release_block(block);
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (sampled) eheap_prof_on_free(ptr);
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Free memory when caller knows requested size. Size picks arena or
+ **         mapped path directly and replaces pointer validation, header is
+ **         only checked to be large enough for the given size.
+ ** \param  ptr - block to free, size - size passed to allocation
+ ** \retval None
+ ******************************************************************************/
+static void eheap_do_free_sized(void* ptr, size_t size)
+{
+  if (!ptr) return;
+#if EHEAP_USE_MMAP_LARGE
+  if ((size >= EHEAP_MMAP_THRESHOLD || !eheap_in_arena(ptr)) && eheap_mmap_free(ptr)) return;
+#endif
+  if (!eheap_arena_user_ptr(ptr)) return; // Foreign pointer, as eheap_free
+  eheap_free_block_t* block = ((eheap_free_block_t*)ptr) - 1;
+  eheap_lock();
+  eheap_stats.total_frees++;
+  if (!eheap_block_sane(block) || block->size < eheap_align_up(size) + sizeof(eheap_free_block_t)) // Size hint does not match block
+  {
+    eheap_unlock();
+    return;
+  }
+#if EHEAP_USE_PROFILER
+  bool sampled = (block->next == EHEAP_PROF_TAG);
+#endif
+  eheap_release_block(block);
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (sampled) eheap_prof_on_free(ptr);
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Insert block into address ordered free list and merge it with free
+ **         neighbours. List never holds adjacent free blocks, so only the two
+ **         neighbours at insertion position need checking. Double free is
+ **         caught here: a block that is already free sits at its insertion
+ **         position or inside preceding free block. Call with heap locked.
+ ** \param  block - allocated block
+ ** \retval None
+ ******************************************************************************/
+static void eheap_release_block(eheap_free_block_t* block)
+{
+#if EHEAP_USE_TREE_INDEX
+  eheap_free_block_t* prev = eheap_tree_floor(block); // Neighbours from address index
+  eheap_link_t* current_ptr = prev ? &prev->next : eheap_free_head;
+#else
+  eheap_link_t* prev_link = NULL;
+  eheap_link_t* current_ptr = eheap_free_head;
+  while (*current_ptr && eheap_link_get(current_ptr) < block) 
+  {
+    EHEAP_NODE_VISIT();
+    prev_link = current_ptr;
+    current_ptr = &eheap_link_get(current_ptr)->next;
+  }
+  eheap_free_block_t* prev = prev_link ? eheap_link_get(prev_link) : NULL;
+#endif
+  eheap_free_block_t* next = eheap_link_get(current_ptr);
+  if (next == block) return; // Already free
+  if (prev && (uint8_t*)prev + prev->size > (uint8_t*)block) return; // Inside free block
+  if (next && (uint8_t*)block + block->size == (uint8_t*)next) // Merge following block
+  {
+    size_t next_size = next->size;
+    eheap_list_remove(current_ptr);
+    block->size += next_size;
+  }
+  if (prev && (uint8_t*)prev + prev->size == (uint8_t*)block) // Merge into preceding block
+  {
+#if EHEAP_USE_TREE_INDEX
+    eheap_link_t* prev_link = eheap_list_slot(prev);
+#endif
+    eheap_list_remove(prev_link);
+    prev->size += block->size;
+    eheap_list_insert(prev_link, prev);
+  }
+  else
+  {
+    eheap_list_insert(current_ptr, block);
+  }
+  eheap_update_stats();
+}
+#endif
+
+#if EHEAP_ENGINE == EHEAP_ENGINE_BUDDY
+/*******************************************************************************
+ ** \brief  Smallest buddy order holding size bytes
+ ** \param  size - block size including header
+ ** \retval Order, block size is 1 << order
+ ******************************************************************************/
+static size_t eheap_buddy_order(size_t size)
+{
+  if (size <= ((size_t)1 << EHEAP_BUDDY_MIN_ORDER)) return EHEAP_BUDDY_MIN_ORDER;
+  return 64 - (size_t)__builtin_clzll((unsigned long long)(size - 1));
+}
+
+/*******************************************************************************
+ ** \brief  Mark block free and push it on free list of its order
+ ** \param  block - block start, order - block order
+ ** \retval None
+ ******************************************************************************/
+static void eheap_buddy_push(eheap_free_block_t* block, size_t order)
+{
+  eheap_free_block_t* first = eheap_link_get(&eheap_buddy_heads[order]);
+  block->size = ((size_t)1 << order) | EHEAP_BUDDY_FREE;
+  eheap_link_set(&block->next, first);
+  eheap_link_set(EHEAP_BUDDY_PREV(block), NULL);
+  if (first) eheap_link_set(EHEAP_BUDDY_PREV(first), block);
+  eheap_link_set(&eheap_buddy_heads[order], block);
+  eheap_buddy_mask |= (size_t)1 << order;
+  eheap_buddy_free_bytes += (size_t)1 << order;
+  eheap_buddy_free_count++;
+}
+
+/*******************************************************************************
+ ** \brief  Unlink free block from free list of its order
+ ** \param  block - free block, order - block order
+ ** \retval None
+ ******************************************************************************/
+static void eheap_buddy_remove(eheap_free_block_t* block, size_t order)
+{
+  eheap_free_block_t* next = eheap_link_get(&block->next);
+  eheap_free_block_t* prev = eheap_link_get(EHEAP_BUDDY_PREV(block));
+  if (prev) eheap_link_set(&prev->next, next);
+  else      eheap_link_set(&eheap_buddy_heads[order], next);
+  if (next) eheap_link_set(EHEAP_BUDDY_PREV(next), prev);
+  if (!eheap_buddy_heads[order]) eheap_buddy_mask &= ~((size_t)1 << order);
+  eheap_buddy_free_bytes -= (size_t)1 << order;
+  eheap_buddy_free_count--;
+}
+
+/*******************************************************************************
+ ** \brief  Carve active region into largest possible top level blocks. Each
+ **         block is smaller than the previous one, so top level blocks never
+ **         have a buddy inside region. Tail below smallest block is cut off.
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_format(void)
+{
+  memset(eheap_buddy_heads, 0, sizeof(eheap_buddy_heads));
+  eheap_buddy_mask = 0;
+  eheap_buddy_free_bytes = 0;
+  eheap_buddy_free_count = 0;
+  eheap_mem_size &= ~(((size_t)1 << EHEAP_BUDDY_MIN_ORDER) - 1);
+  size_t offset = 0;
+  while (offset < eheap_mem_size)
+  {
+    size_t order = 63 - (size_t)__builtin_clzll((unsigned long long)(eheap_mem_size - offset));
+    eheap_buddy_push((eheap_free_block_t*)(eheap_mem + offset), order);
+    offset += (size_t)1 << order;
+  }
+}
+
+/*******************************************************************************
+ ** \brief  Update heap statistics from counters kept by free lists, O(1)
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_update_stats(void)
+{
+  eheap_stats.current_usage = eheap_mem_size - eheap_buddy_free_bytes;
+  eheap_stats.largest_free_block = eheap_buddy_mask ? (size_t)1 << (63 - __builtin_clzll((unsigned long long)eheap_buddy_mask)) : 0;
+  if (eheap_stats.current_usage > eheap_stats.peak_usage) eheap_stats.peak_usage = eheap_stats.current_usage;
+  if (eheap_buddy_free_count > 1) eheap_stats.fragmentation = (eheap_buddy_free_count * 100) / (eheap_mem_size / sizeof(eheap_free_block_t));
+  else                            eheap_stats.fragmentation = 0;
+#if EHEAP_USE_PRESSURE
+  eheap_watermark_update();
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Take free block of given order, splitting larger block if needed.
+ **         Call with heap locked.
+ ** \param  order - requested order
+ ** \retval Allocated block or NULL
+ ******************************************************************************/
+static eheap_free_block_t* eheap_buddy_take(size_t order)
+{
+  if (order >= EHEAP_BUDDY_ORDERS) return NULL;
+  size_t avail = eheap_buddy_mask & ~(((size_t)1 << order) - 1);
+  if (!avail) return NULL;
+  size_t current = (size_t)__builtin_ctzll((unsigned long long)avail);
+  eheap_free_block_t* block = eheap_link_get(&eheap_buddy_heads[current]);
+  eheap_buddy_remove(block, current);
+  while (current > order) // Upper halves go back to free lists
+  {
+    EHEAP_NODE_VISIT();
+    current--;
+    eheap_buddy_push((eheap_free_block_t*)((uint8_t*)block + ((size_t)1 << current)), current);
+  }
+  block->size = (size_t)1 << order;
+  block->next = 0;
+  return block;
+}
+
+/*******************************************************************************
+ ** \brief  Grow allocated block in place by absorbing its upper buddies. Only
+ **         possible when block is the lower half at every level up to order.
+ **         Call with heap locked.
+ ** \param  block - allocated block, order - requested order
+ ** \retval true if block was grown
+ ******************************************************************************/
+static bool eheap_buddy_grow(eheap_free_block_t* block, size_t order)
+{
+  size_t offset = (size_t)((uint8_t*)block - eheap_mem);
+  size_t current = (size_t)__builtin_ctzll((unsigned long long)block->size);
+  if (order >= EHEAP_BUDDY_ORDERS || (offset & (((size_t)1 << order) - 1)) != 0) return false;
+  if (((size_t)1 << order) > eheap_mem_size - offset) return false;
+  for (size_t k = current; k < order; k++)
+  {
+    EHEAP_NODE_VISIT();
+    eheap_free_block_t* upper = (eheap_free_block_t*)((uint8_t*)block + ((size_t)1 << k));
+    if (upper->size != (((size_t)1 << k) | EHEAP_BUDDY_FREE)) return false;
+  }
+  for (size_t k = current; k < order; k++)
+  {
+    eheap_buddy_remove((eheap_free_block_t*)((uint8_t*)block + ((size_t)1 << k)), k);
+  }
+  block->size = (size_t)1 << order;
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Resolve header in front of user pointer to allocated buddy block.
+ **         Aligned allocations place a proxy header there whose next field is
+ **         a link back to the block (negative, unlike 0 or profiler tag).
+ ** \param  header - header in front of user pointer
+ ** \retval Allocated buddy block or NULL if header is not sane or block is free
+ ******************************************************************************/
+static eheap_free_block_t* eheap_buddy_owner(eheap_free_block_t* header)
+{
+  eheap_free_block_t* block = header;
+  if (!(block->size & EHEAP_BUDDY_FREE) && block->next < 0) block = eheap_link_get(&block->next);
+  if (!eheap_in_arena(block)) return NULL;
+  size_t size = block->size;
+  size_t offset = (size_t)((uint8_t*)block - eheap_mem);
+  if (size & EHEAP_BUDDY_FREE) return NULL; // Already free
+  if (size < ((size_t)1 << EHEAP_BUDDY_MIN_ORDER) || (size & (size - 1)) != 0) return NULL;
+  if ((offset & (size - 1)) != 0 || size > eheap_mem_size - offset) return NULL;
+  if (header != block && header->size != (size_t)((uint8_t*)block + size - (uint8_t*)header)) return NULL; // Proxy must end with block
+  return block;
+}
+
+/*******************************************************************************
+ ** \brief  Return block to free lists, merging with free buddy while possible.
+ **         Call with heap locked.
+ ** \param  block - allocated buddy block
+ ** \retval None
+ ******************************************************************************/
+static void eheap_buddy_release(eheap_free_block_t* block)
+{
+  size_t offset = (size_t)((uint8_t*)block - eheap_mem);
+  size_t order = (size_t)__builtin_ctzll((unsigned long long)block->size);
+  while (order + 1 < EHEAP_BUDDY_ORDERS)
+  {
+    EHEAP_NODE_VISIT();
+    size_t size = (size_t)1 << order;
+    size_t buddy_offset = offset ^ size;
+    if (buddy_offset > eheap_mem_size - size) break; // Top level block
+    eheap_free_block_t* buddy = (eheap_free_block_t*)(eheap_mem + buddy_offset);
+    if (buddy->size != (size | EHEAP_BUDDY_FREE)) break;
+    eheap_buddy_remove(buddy, order);
+    offset &= ~size;
+    order++;
+  }
+  eheap_buddy_push((eheap_free_block_t*)(eheap_mem + offset), order);
+  eheap_update_stats();
+}
+
+/*******************************************************************************
+ ** \brief  Check that blocks tile region and free lists hold exactly the free
+ **         blocks. Call with heap locked.
+ ** \param  total_free - output, free bytes found
+ ** \retval true if consistent
+ ******************************************************************************/
+static bool eheap_buddy_check(size_t* total_free)
+{
+  size_t free_count = 0;
+  size_t offset = 0;
+  while (offset < eheap_mem_size)
+  {
+    eheap_free_block_t* block = (eheap_free_block_t*)(eheap_mem + offset);
+    size_t size = block->size & ~EHEAP_BUDDY_FREE;
+    if (size < ((size_t)1 << EHEAP_BUDDY_MIN_ORDER) || (size & (size - 1)) != 0) return false;
+    if ((offset & (size - 1)) != 0 || size > eheap_mem_size - offset) return false;
+    if (block->size & EHEAP_BUDDY_FREE)
+    {
+      *total_free += size;
+      free_count++;
+    }
+    offset += size;
+  }
+  size_t listed = 0;
+  for (size_t order = 0; order < EHEAP_BUDDY_ORDERS; order++)
+  {
+    eheap_free_block_t* block = eheap_link_get(&eheap_buddy_heads[order]);
+    if (!block != !(eheap_buddy_mask & ((size_t)1 << order))) return false;
+    for (; block; block = eheap_link_get(&block->next))
+    {
+      if (!eheap_in_arena(block) || block->size != (((size_t)1 << order) | EHEAP_BUDDY_FREE)) return false;
+      if (++listed > free_count) return false;
+    }
+  }
+  return listed == free_count && listed == eheap_buddy_free_count && *total_free == eheap_buddy_free_bytes;
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory from smallest power of two block holding it
+ ** \param  size - requested size
+ ** \retval Pointer or NULL
+ ******************************************************************************/
+static void* eheap_do_alloc(size_t size)
+{
+  EHEAP_FIT_FAILED(false);
+#if EHEAP_USE_MMAP_LARGE
+  if (size >= EHEAP_MMAP_THRESHOLD)
+  {
+    void* mapped = eheap_mmap_alloc(size, EHEAP_ALIGNMENT);
+    if (mapped) return mapped; // Otherwise try arena
+  }
+#endif
+  if(size == 0 || size > eheap_mem_size - sizeof(eheap_free_block_t))
+  {
+    eheap_count_failure();
+    return NULL;
+  }
+  eheap_lock();
+  eheap_stats.total_allocations++;
+  size_t aligned_size = eheap_align_up(size);
+  eheap_free_block_t* block = eheap_buddy_take(eheap_buddy_order(aligned_size + sizeof(eheap_free_block_t)));
+  if (!block)
+  {
+    eheap_stats.alloc_failures++;
+    EHEAP_FIT_FAILED(true);
+    eheap_unlock();
+    return NULL;
+  }
+  void* user_ptr = (void*)(block + 1);
+  memset(user_ptr, 0, aligned_size);
+  eheap_update_stats();
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (eheap_prof_on_alloc(user_ptr, size, eheap_prof_caller)) block->next = EHEAP_PROF_TAG;
+#endif
+  return user_ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory with user pointer aligned to power of two
+ **         alignment. Block is over-allocated by alignment, aligned user
+ **         pointer gets proxy header linking back to block.
+ ** \param  alignment - required alignment, size - requested size
+ ** \retval Pointer to aligned memory or NULL
+ ******************************************************************************/
+static void* eheap_do_alloc_aligned(size_t alignment, size_t size)
+{
+  if (alignment <= EHEAP_ALIGNMENT) return eheap_do_alloc(size);
+  EHEAP_FIT_FAILED(false);
+#if EHEAP_USE_MMAP_LARGE
+  if (size >= EHEAP_MMAP_THRESHOLD && (alignment & (alignment - 1)) == 0)
+  {
+    void* mapped = eheap_mmap_alloc(size, alignment);
+    if (mapped) return mapped;
+  }
+#endif
+  if ((alignment & (alignment - 1)) != 0 || size == 0 || alignment >= eheap_mem_size ||
+      size > eheap_mem_size - alignment - 2 * sizeof(eheap_free_block_t))
+  {
+    eheap_count_failure();
+    return NULL;
+  }
+  eheap_lock();
+  eheap_stats.total_allocations++;
+  size_t aligned_size = eheap_align_up(size);
+  eheap_free_block_t* block = eheap_buddy_take(eheap_buddy_order(aligned_size + alignment + 2 * sizeof(eheap_free_block_t)));
+  if (!block)
+  {
+    eheap_stats.alloc_failures++;
+    EHEAP_FIT_FAILED(true);
+    eheap_unlock();
+    return NULL;
+  }
+  eheap_free_block_t* header = block;
+  if (((uintptr_t)(block + 1) & (alignment - 1)) != 0) // Room for proxy header behind block header
+  {
+    uintptr_t user = ((uintptr_t)(block + 2) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    header = (eheap_free_block_t*)user - 1;
+    header->size = (size_t)((uint8_t*)block + block->size - (uint8_t*)header);
+    eheap_link_set(&header->next, block);
+  }
+  void* user_ptr = (void*)(header + 1);
+  memset(user_ptr, 0, aligned_size);
+  eheap_update_stats();
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (eheap_prof_on_alloc(user_ptr, size, eheap_prof_caller)) block->next = EHEAP_PROF_TAG;
+#endif
+  return user_ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Allocate memory placed by expected lifetime. Buddy placement is
+ **         fixed by block order, so hints are accepted and ignored.
+ ** \param  size - requested size, flags - EHEAP_HINT_* flags
+ ** \retval Pointer or NULL
+ ******************************************************************************/
+static void* eheap_do_alloc_hint(size_t size, unsigned int flags)
+{
+  (void)flags;
+  return eheap_do_alloc(size);
+}
+
+/*******************************************************************************
+ ** \brief  Reallocate memory, growing in place by merging free upper buddies
+ ** \param  ptr - block to resize, old_size_hint - size caller last requested
+ **         for ptr or 0 if unknown, new_size - requested size
+ ** \retval Resized block or NULL
+ ******************************************************************************/
+static void* eheap_do_realloc(void* ptr, size_t old_size_hint, size_t new_size)
+{
+  if (!ptr) return eheap_alloc(new_size);
+  if (new_size == 0) { old_size_hint ? eheap_free_sized(ptr, old_size_hint) : eheap_free(ptr); return NULL;}
+#if EHEAP_USE_MMAP_LARGE
+  if (!eheap_in_arena(ptr)) return eheap_mmap_realloc(ptr, new_size);
+#endif
+  if (old_size_hint ? !eheap_arena_user_ptr(ptr) : !eheap_validate_ptr(ptr)) return NULL; // Known size skips only mapped lookup
+  eheap_lock();
+  eheap_free_block_t* header = ((eheap_free_block_t*)ptr) - 1;
+  eheap_free_block_t* block = eheap_buddy_owner(header);
+  if (!block)
+  {
+    eheap_unlock();
+    return NULL;
+  }
+  size_t old_size = header->size - sizeof(eheap_free_block_t);
+  if (new_size <= old_size){ eheap_unlock(); return ptr; }
+  if (block == header && new_size <= eheap_mem_size - sizeof(eheap_free_block_t) &&
+      eheap_buddy_grow(block, eheap_buddy_order(eheap_align_up(new_size) + sizeof(eheap_free_block_t))))
+  {
+    eheap_update_stats();
+    eheap_unlock();
+#if EHEAP_USE_PROFILER
+    if (block->next == EHEAP_PROF_TAG) eheap_prof_on_resize(ptr, ptr, new_size);
+#endif
+    return ptr;
+  }
+  eheap_unlock();
+  void* new_ptr = eheap_alloc(new_size);
+  if (new_ptr) 
+  {
+    if (old_size_hint)
+    {
+      memcpy(new_ptr, ptr, old_size_hint < old_size ? old_size_hint : old_size); // Copy only live bytes
+      eheap_free_sized(ptr, old_size_hint);
+    }
+    else
+    {
+      memcpy(new_ptr, ptr, old_size);
+      eheap_free(ptr);
+    }
+  }
+  return new_ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Free memory, header checks are O(1), double free is caught by free
+ **         flag of block
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_do_free(void* ptr)
+{
+#if EHEAP_USE_MMAP_LARGE
+  if (ptr && !eheap_in_arena(ptr) && eheap_mmap_free(ptr)) return;
+#endif
+  if (!ptr || !eheap_validate_ptr(ptr)) return;
+  eheap_do_free_sized(ptr, 0);
+}
+
+/*******************************************************************************
+ ** \brief  Free memory when caller knows requested size
+ ** \param  ptr - block to free, size - size passed to allocation
+ ** \retval None
+ ******************************************************************************/
+static void eheap_do_free_sized(void* ptr, size_t size)
+{
+  if (!ptr) return;
+#if EHEAP_USE_MMAP_LARGE
+  if ((size >= EHEAP_MMAP_THRESHOLD || !eheap_in_arena(ptr)) && eheap_mmap_free(ptr)) return;
+#endif
+  if (!eheap_arena_user_ptr(ptr)) return; // Foreign pointer, as eheap_free
+  eheap_free_block_t* header = ((eheap_free_block_t*)ptr) - 1;
+  eheap_lock();
+  eheap_stats.total_frees++;
+  eheap_free_block_t* block = eheap_buddy_owner(header);
+  if (!block || header->size < eheap_align_up(size) + sizeof(eheap_free_block_t))
+  {
+    eheap_unlock();
+    return;
+  }
+#if EHEAP_USE_PROFILER
+  bool sampled = (block->next == EHEAP_PROF_TAG);
+#endif
+  eheap_buddy_release(block);
+  eheap_unlock();
+#if EHEAP_USE_PROFILER
+  if (sampled) eheap_prof_on_free(ptr);
+#endif
+}
+#endif
+
+#if EHEAP_USE_PRESSURE
+/*******************************************************************************
+ ** \brief  Track usage against watermarks, call with heap locked. Crossing is
+ **         recorded for calling thread and reported after unlock.
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_watermark_update(void)
+{
+  if (!eheap_watermark_handler) return;
+  size_t usage = eheap_stats.current_usage;
+  bool above = eheap_watermark_above ? usage > eheap_watermark_low : usage >= eheap_watermark_high;
+  if (above == eheap_watermark_above) return;
+  eheap_watermark_above = above;
+  eheap_watermark_event.handler = eheap_watermark_handler;
+  eheap_watermark_event.ctx = eheap_watermark_ctx;
+  eheap_watermark_event.high = above;
+  eheap_watermark_event.usage = usage;
+}
+
+/*******************************************************************************
+ ** \brief  Report watermark crossing recorded by this thread, call unlocked
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_watermark_fire(void)
+{
+  if (!eheap_watermark_event.handler) return;
+  eheap_watermark_event_t event = eheap_watermark_event;
+  eheap_watermark_event.handler = NULL;
+  event.handler(event.high, event.usage, event.ctx);
+}
+
+/*******************************************************************************
+ ** \brief  Ask pressure handlers to release memory after failed fit, in
+ **         descending priority until needed bytes are released. Handlers run
+ **         unlocked and may free; allocations they make do not reclaim again.
+ ** \param  size - requested size
+ ** \retval true if any handler released memory and allocation is worth retry
+ ******************************************************************************/
+static bool eheap_pressure_reclaim(size_t size)
+{
+  if (size == 0 || eheap_pressure_busy) return false;
+  eheap_pressure_entry_t handlers[EHEAP_PRESSURE_MAX_HANDLERS];
+  eheap_lock();
+  size_t count = eheap_pressure_count;
+  memcpy(handlers, eheap_pressure_handlers, count * sizeof(handlers[0]));
+  eheap_unlock();
+  size_t released = 0;
+#if EHEAP_USE_PROFILER
+  void* caller = eheap_prof_caller; // Handler allocations are profiled at their own call sites
+  eheap_prof_caller = NULL;
+#endif
+  eheap_pressure_busy = true;
+  for (size_t i = 0; i < count && released < size; i++) released += handlers[i].handler(size - released, handlers[i].ctx);
+  eheap_pressure_busy = false;
+#if EHEAP_USE_PROFILER
+  eheap_prof_caller = caller;
+#endif
+  return released > 0;
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  Public entry points, timed when EHEAP_USE_OPSTATS is enabled.
+ **         With EHEAP_USE_PRESSURE failed fit is retried once after reclaim
+ **         and watermark crossings are reported on return.
+ ** \param  See eheap_do_* functions
+ ** \retval See eheap_do_* functions
+ ******************************************************************************/
+void* eheap_alloc(size_t size)
+{
+  EHEAP_OP_BEGIN();
+  EHEAP_PROF_ENTER();
+  void* ptr = eheap_do_alloc(size);
+  EHEAP_RECLAIM_RETRY(ptr, size, eheap_do_alloc(size));
+  EHEAP_PROF_LEAVE();
+  EHEAP_OP_END(alloc);
+  EHEAP_WATERMARK_FIRE();
+  return ptr;
+}
+
+void* eheap_alloc_aligned(size_t alignment, size_t size)
+{
+  EHEAP_OP_BEGIN();
+  EHEAP_PROF_ENTER();
+  void* ptr = eheap_do_alloc_aligned(alignment, size);
+  EHEAP_RECLAIM_RETRY(ptr, size, eheap_do_alloc_aligned(alignment, size));
+  EHEAP_PROF_LEAVE();
+  EHEAP_OP_END(alloc);
+  EHEAP_WATERMARK_FIRE();
+  return ptr;
+}
+
+void* eheap_alloc_hint(size_t size, unsigned int flags)
+{
+  EHEAP_OP_BEGIN();
+  EHEAP_PROF_ENTER();
+  void* ptr = eheap_do_alloc_hint(size, flags);
+  EHEAP_RECLAIM_RETRY(ptr, size, eheap_do_alloc_hint(size, flags));
+  EHEAP_PROF_LEAVE();
+  EHEAP_OP_END(alloc);
+  EHEAP_WATERMARK_FIRE();
+  return ptr;
+}
+
+void* eheap_realloc(void* ptr, size_t new_size)
+{
+  EHEAP_OP_BEGIN();
+  EHEAP_PROF_ENTER();
+  void* new_ptr = eheap_do_realloc(ptr, 0, new_size);
+  EHEAP_PROF_LEAVE();
+  EHEAP_OP_END(realloc);
+  EHEAP_WATERMARK_FIRE();
+  return new_ptr;
+}
+
+void* eheap_realloc_sized(void* ptr, size_t old_size, size_t new_size)
+{
+  EHEAP_OP_BEGIN();
+  EHEAP_PROF_ENTER();
+  void* new_ptr = eheap_do_realloc(ptr, old_size, new_size);
+  EHEAP_PROF_LEAVE();
+  EHEAP_OP_END(realloc);
+  EHEAP_WATERMARK_FIRE();
+  return new_ptr;
+}
+
+void eheap_free(void* ptr)
+{
+  EHEAP_OP_BEGIN();
+  eheap_do_free(ptr);
+  EHEAP_OP_END(free);
+  EHEAP_WATERMARK_FIRE();
+}
+
+void eheap_free_sized(void* ptr, size_t size)
+{
+  EHEAP_OP_BEGIN();
+  eheap_do_free_sized(ptr, size);
+  EHEAP_OP_END(free);
+  EHEAP_WATERMARK_FIRE();
+}
+
+/*******************************************************************************
+ ** \brief  Get usable size of block, may exceed requested size because of
+ **         alignment, unsplit remainder or page rounding
+ ** \param  ptr - pointer returned by allocation
+ ** \retval Bytes usable at ptr, 0 for invalid pointer
+ ******************************************************************************/
+size_t eheap_usable_size(void* ptr)
+{
+  if (!eheap_validate_ptr(ptr)) return 0;
+  eheap_free_block_t* block = ((eheap_free_block_t*)ptr) - 1;
+  return block->size - sizeof(eheap_free_block_t);
+}
+
+/*******************************************************************************
+ ** \brief  Get extended statistics with per-operation timing. Operation
+ **         part stays zero when EHEAP_USE_OPSTATS is disabled.
+ ** \param  stats - output
+ ** \retval None
+ ******************************************************************************/
+void eheap_get_ext_stats(eheap_ext_stats_t* stats)
+{
+  if (!stats) return;
+  memset(stats, 0, sizeof(*stats));
+#if EHEAP_USE_OPSTATS
+  eheap_op_collect(&stats->alloc, &eheap_ext_stats.alloc, false);
+  eheap_op_collect(&stats->free, &eheap_ext_stats.free, false);
+  eheap_op_collect(&stats->realloc, &eheap_ext_stats.realloc, false);
+#endif
+  eheap_stats_read(&stats->heap, NULL);
+  eheap_op_stats_t* ops[] = {&stats->alloc, &stats->free, &stats->realloc};
+  for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+  {
+    if (!ops[i]->count) continue;
+    ops[i]->cycles_mean = ops[i]->cycles_total / ops[i]->count;
+    ops[i]->nodes_mean = ops[i]->nodes_total / ops[i]->count;
+  }
+}
+
+/*******************************************************************************
+ ** \brief  Get heap statistics, lock-free snapshot of last completed
+ **         operation
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+void eheap_get_stats(eheap_stats_t* stats)
+{
+  if (!stats) return;
+  eheap_stats_read(stats, NULL);
+}
+
+/*******************************************************************************
+ ** \brief  Get heap usage percentage (0-100), lock-free
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+size_t eheap_get_usage_percent(void)
+{
+  eheap_stats_t stats;
+  size_t mem_size;
+  eheap_stats_read(&stats, &mem_size);
+  return mem_size ? (stats.current_usage *100) /mem_size : 0;
+}
+
+/*******************************************************************************
+ ** \brief  Check if heap is valid (debug function)
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+bool eheap_validate(void)
+{
+  eheap_lock();
+  bool valid = eheap_check();
+  eheap_unlock();
+  return valid;
+}
+
+/*******************************************************************************
+ ** \brief  Check free list, index and statistics of active heap. Call with
+ **         heap locked.
+ ** \param  None
+ ** \retval true if heap is consistent
+ ******************************************************************************/
+static bool eheap_check(void)
+{
+  bool valid = true;
   size_t total_free = 0;
-  eheap_free_block_t* current = eheap_free_list;
+#if EHEAP_ENGINE == EHEAP_ENGINE_BUDDY
+  valid = eheap_buddy_check(&total_free);
+#else
+  size_t free_count = 0;
+  eheap_free_block_t* current = eheap_link_get(eheap_free_head);
   eheap_free_block_t* prev = NULL;
   while (current) 
   {
-    if ((uint8_t*)current < eheap || (uint8_t*)current + current->size > eheap + EHEAP_SIZE) // Check if block is within heap bounds
+    if ((uint8_t*)current < eheap_mem || (uint8_t*)current + current->size > eheap_mem + eheap_mem_size) // Check if block is within heap bounds
     {
       valid = false;
       break;
@@ -393,12 +2301,41 @@ bool eheap_validate(void)
       valid = false;
       break;
     }
+#if EHEAP_USE_TREE_INDEX
+    if (eheap_tree_floor(current) != prev || current->size < EHEAP_MIN_BLOCK)
+    {
+      valid = false;
+      break;
+    }
+#endif
     total_free += current->size;
+    free_count++;
     prev = current;
-    current = current->next;
+    current = eheap_link_get(&current->next);
   }
-  if(valid && (total_free + eheap_stats.current_usage != EHEAP_SIZE)) valid = false;
-  eheap_unlock();
+#if EHEAP_USE_TREE_INDEX
+  size_t indexed = 0;
+  size_t addressed = 0;
+  if (valid && (!eheap_tree_check(eheap_link_get(&eheap_tree_size_root), EHEAP_TREE_BY_SIZE, NULL, NULL, &indexed) ||
+                !eheap_tree_check(eheap_link_get(&eheap_tree_addr_root), EHEAP_TREE_BY_ADDR, NULL, NULL, &addressed) ||
+                indexed != free_count || addressed != free_count || free_count != eheap_tree_free_count || total_free != eheap_tree_free_bytes)) valid = false;
+#endif
+#endif
+  if(valid && (total_free + eheap_stats.current_usage != eheap_mem_size)) valid = false;
+#if EHEAP_USE_MMAP_LARGE
+  size_t mapped_regions = 0;
+  size_t mapped_usage = 0;
+  for (size_t i = 0; valid && i < EHEAP_MMAP_MAX_REGIONS; i++) // Mapped block header must match side table
+  {
+    eheap_mmap_region_t* region = &eheap_mmap_regions[i];
+    if (!region->base) continue;
+    eheap_free_block_t* block = (eheap_free_block_t*)(region->base + region->offset) - 1;
+    if (!region->busy && block->size != region->length - region->offset + sizeof(eheap_free_block_t)) valid = false;
+    mapped_regions++;
+    mapped_usage += region->length;
+  }
+  if(valid && (mapped_regions != eheap_stats.mapped_regions || mapped_usage != eheap_stats.mapped_usage)) valid = false;
+#endif
   return valid;
 }
 
@@ -414,4 +2351,378 @@ void eheap_reset_stats(void)
   eheap_stats.total_frees = 0;
   eheap_stats.alloc_failures = 0;
   eheap_unlock();
-}
\ No newline at end of file
+#if EHEAP_USE_OPSTATS
+  eheap_op_stats_t discard;
+  eheap_op_collect(&discard, &eheap_ext_stats.alloc, true);
+  eheap_op_collect(&discard, &eheap_ext_stats.free, true);
+  eheap_op_collect(&discard, &eheap_ext_stats.realloc, true);
+#endif
+}
+#if EHEAP_USE_PERSIST
+/*******************************************************************************
+ ** \brief  Check that blocks tile heap region and every free list entry sits
+ **         on block boundary. Free list links are compared, never followed
+ **         outside region.
+ ** \param  mem - heap region, size - region size, head - link to first free block
+ ** \retval true if layout is consistent
+ ******************************************************************************/
+static bool eheap_persist_check_layout(uint8_t* mem, size_t size, eheap_link_t* head)
+{
+  uint8_t* pos = mem;
+  eheap_free_block_t* free_block = eheap_link_get(head);
+  while (pos < mem + size)
+  {
+    eheap_free_block_t* block = (eheap_free_block_t*)pos;
+    if (block->size < EHEAP_MIN_BLOCK || (block->size & (EHEAP_ALIGNMENT - 1)) != 0) return false;
+    if (block->size > (size_t)(mem + size - pos)) return false;
+    if (block == free_block)
+    {
+      free_block = eheap_link_get(&block->next);
+      if (free_block && free_block <= block) return false; // Free list must be address ordered
+    }
+    pos += block->size;
+  }
+  return free_block == NULL;
+}
+
+/*******************************************************************************
+ ** \brief  Open or create file backed heap and make it the active heap. Free
+ **         list head and root object live in the file header, all links are
+ **         self-relative, so the file may be mapped at any address. Existing
+ **         file is checked block by block and with eheap_validate.
+ ** \param  path - heap file, size - file size when file is created
+ ** \retval true on success
+ ******************************************************************************/
+bool eheap_persist_open(const char* path, size_t size)
+{
+  if (!path || eheap_persist_hdr) return false;
+  int fd = open(path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) return false;
+  struct stat st;
+  size_t heap_offset = eheap_align_up(sizeof(eheap_persist_hdr_t));
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    return false;
+  }
+  bool fresh = (st.st_size == 0);
+  if (fresh)
+  {
+    if (size < heap_offset + EHEAP_MIN_BLOCK || ftruncate(fd, (off_t)size) != 0)
+    {
+      close(fd);
+      return false;
+    }
+  }
+  else
+  {
+    size = (size_t)st.st_size;
+  }
+  uint8_t* map = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    close(fd);
+    return false;
+  }
+  eheap_persist_hdr_t* hdr = (eheap_persist_hdr_t*)map;
+  if (fresh)
+  {
+    hdr->version = EHEAP_PERSIST_VERSION;
+    hdr->map_size = size;
+    hdr->heap_offset = heap_offset;
+    hdr->heap_size = (size - heap_offset) & ~(size_t)(EHEAP_ALIGNMENT - 1);
+    eheap_free_block_t* first = (eheap_free_block_t*)(map + heap_offset);
+    first->size = hdr->heap_size;
+    first->next = 0;
+    eheap_link_set(&hdr->free_head, first);
+    hdr->root = 0;
+    hdr->magic = EHEAP_PERSIST_MAGIC; // Written last, half created file is rejected
+  }
+  else if (size < sizeof(eheap_persist_hdr_t) || hdr->magic != EHEAP_PERSIST_MAGIC ||
+           hdr->version != EHEAP_PERSIST_VERSION || hdr->map_size != size ||
+           hdr->heap_offset != heap_offset || hdr->heap_size > size - heap_offset ||
+           !eheap_persist_check_layout(map + heap_offset, hdr->heap_size, &hdr->free_head))
+  {
+    munmap(map, size);
+    close(fd);
+    return false;
+  }
+  eheap_init_mutex();
+  eheap_lock();
+  uint8_t* old_mem = eheap_mem; // Kept active if file heap is rejected
+  size_t old_mem_size = eheap_mem_size;
+  eheap_link_t* old_free_head = eheap_free_head;
+  eheap_stats_t old_stats = eheap_stats;
+#if EHEAP_USE_PRESSURE
+  bool old_above = eheap_watermark_above;
+  eheap_watermark_event_t old_event = eheap_watermark_event;
+#endif
+  eheap_mem = map + heap_offset;
+  eheap_mem_size = hdr->heap_size;
+  eheap_free_head = &hdr->free_head;
+#if EHEAP_USE_TREE_INDEX
+  eheap_tree_rebuild(); // Index links are not trusted from file
+#endif
+  memset(&eheap_stats, 0, sizeof(eheap_stats));
+  eheap_update_stats();
+  if (!eheap_check())
+  {
+    eheap_mem = old_mem;
+    eheap_mem_size = old_mem_size;
+    eheap_free_head = old_free_head;
+#if EHEAP_USE_TREE_INDEX
+    eheap_tree_rebuild();
+#endif
+    eheap_stats = old_stats;
+#if EHEAP_USE_PRESSURE
+    eheap_watermark_above = old_above;
+    eheap_watermark_event = old_event;
+#endif
+    eheap_unlock();
+    munmap(map, size);
+    close(fd);
+    return false;
+  }
+  eheap_persist_hdr = hdr;
+  eheap_persist_fd = fd;
+#if EHEAP_USE_PRESSURE
+  eheap_watermark_above = false;
+#endif
+#if EHEAP_USE_FASTPATH
+  __atomic_store_n(&eheap_fast_generation, eheap_fast_generation + 1, __ATOMIC_RELAXED); // Cached blocks of all threads belong to old heap
+#endif
+  eheap_update_stats();
+  eheap_unlock();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Flush file backed heap to disk
+ ** \param  None
+ ** \retval true if msync succeeded
+ ******************************************************************************/
+bool eheap_persist_checkpoint(void)
+{
+  eheap_lock();
+  bool ok = eheap_persist_hdr && msync(eheap_persist_hdr, eheap_persist_hdr->map_size, MS_SYNC) == 0;
+  eheap_unlock();
+  return ok;
+}
+
+/*******************************************************************************
+ ** \brief  Checkpoint and unmap file backed heap, static heap becomes active
+ **         again (reinitialized)
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+void eheap_persist_close(void)
+{
+  eheap_lock();
+  if (!eheap_persist_hdr)
+  {
+    eheap_unlock();
+    return;
+  }
+  size_t map_size = eheap_persist_hdr->map_size;
+  msync(eheap_persist_hdr, map_size, MS_SYNC);
+  munmap(eheap_persist_hdr, map_size);
+  close(eheap_persist_fd);
+  eheap_persist_hdr = NULL;
+  eheap_persist_fd = -1;
+  eheap_unlock();
+  eheap_init();
+}
+
+/*******************************************************************************
+ ** \brief  Get root object of file backed heap
+ ** \param  None
+ ** \retval Root object pointer or NULL
+ ******************************************************************************/
+void* eheap_persist_get_root(void)
+{
+  eheap_lock();
+  void* root = eheap_persist_hdr ? (void*)eheap_link_get(&eheap_persist_hdr->root) : NULL;
+  eheap_unlock();
+  return root;
+}
+
+/*******************************************************************************
+ ** \brief  Set root object of file backed heap, entry point for finding data
+ **         after restart
+ ** \param  ptr - pointer returned by eheap_alloc or NULL
+ ** \retval None
+ ******************************************************************************/
+void eheap_persist_set_root(void* ptr)
+{
+  if (ptr && !eheap_validate_ptr(ptr)) return;
+  eheap_lock();
+  if (eheap_persist_hdr) eheap_link_set(&eheap_persist_hdr->root, (eheap_free_block_t*)ptr);
+  eheap_unlock();
+}
+#endif
+#if EHEAP_USE_PRESSURE
+/*******************************************************************************
+ ** \brief  Register handler asked to release memory when allocation finds no
+ **         fit. Registering same handler and context again changes priority.
+ ** \param  handler - returns bytes it released, ctx - passed to handler,
+ **         priority - higher priority handlers run first
+ ** \retval true on success, false if handler is NULL or table is full
+ ******************************************************************************/
+bool eheap_pressure_register(eheap_pressure_handler_t handler, void* ctx, int priority)
+{
+  if (!handler) return false;
+  eheap_pressure_unregister(handler, ctx);
+  eheap_lock();
+  if (eheap_pressure_count == EHEAP_PRESSURE_MAX_HANDLERS)
+  {
+    eheap_unlock();
+    return false;
+  }
+  size_t pos = eheap_pressure_count;
+  while (pos > 0 && eheap_pressure_handlers[pos - 1].priority < priority) // Equal priorities keep registration order
+  {
+    eheap_pressure_handlers[pos] = eheap_pressure_handlers[pos - 1];
+    pos--;
+  }
+  eheap_pressure_handlers[pos].handler = handler;
+  eheap_pressure_handlers[pos].ctx = ctx;
+  eheap_pressure_handlers[pos].priority = priority;
+  eheap_pressure_count++;
+  eheap_unlock();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  Remove pressure handler
+ ** \param  handler, ctx - as registered
+ ** \retval true if handler was registered
+ ******************************************************************************/
+bool eheap_pressure_unregister(eheap_pressure_handler_t handler, void* ctx)
+{
+  bool found = false;
+  eheap_lock();
+  for (size_t i = 0; i < eheap_pressure_count; i++)
+  {
+    if (!found && eheap_pressure_handlers[i].handler == handler && eheap_pressure_handlers[i].ctx == ctx) found = true;
+    if (found && i + 1 < eheap_pressure_count) eheap_pressure_handlers[i] = eheap_pressure_handlers[i + 1];
+  }
+  if (found) eheap_pressure_count--;
+  eheap_unlock();
+  return found;
+}
+
+/*******************************************************************************
+ ** \brief  Set usage watermarks. Handler is called with high set once
+ **         current_usage reaches high mark, and with high cleared once it
+ **         drops to low mark again. It runs after heap is unlocked, on thread
+ **         whose operation crossed the mark. Usage already at high mark is
+ **         reported right away.
+ ** \param  high - high mark in bytes, low - low mark in bytes, not above high,
+ **         handler - NULL disables watermarks, ctx - passed to handler
+ ** \retval true on success, false if low is above high
+ ******************************************************************************/
+bool eheap_set_watermarks(size_t high, size_t low, eheap_watermark_handler_t handler, void* ctx)
+{
+  if (low > high) return false;
+  eheap_lock();
+  eheap_watermark_high = high;
+  eheap_watermark_low = low;
+  eheap_watermark_handler = handler;
+  eheap_watermark_ctx = ctx;
+  eheap_watermark_above = false;
+  eheap_watermark_event.handler = NULL;
+  eheap_watermark_update();
+  eheap_unlock();
+  eheap_watermark_fire();
+  return true;
+}
+#endif
+#if EHEAP_USE_FASTPATH
+#if EHEAP_USE_PTHREAD
+/*******************************************************************************
+ ** \brief  Create key whose destructor runs on thread exit
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_fast_key_create(void)
+{
+  pthread_key_create(&eheap_fast_key, eheap_fast_thread_exit);
+}
+
+/*******************************************************************************
+ ** \brief  Return caches of exiting thread to heap
+ ** \param  arg - key value, unused
+ ** \retval None
+ ******************************************************************************/
+static void eheap_fast_thread_exit(void* arg)
+{
+  (void)arg;
+  eheap_fast_flush();
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  Set up caches of calling thread for current heap. Blocks cached
+ **         for replaced heap are dropped, they are not in current heap.
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_fast_attach(void)
+{
+  memset(eheap_fast_bins, 0, sizeof(eheap_fast_bins));
+  eheap_fast_bins_generation = __atomic_load_n(&eheap_fast_generation, __ATOMIC_RELAXED);
+#if EHEAP_USE_PTHREAD
+  pthread_once(&eheap_fast_key_once, eheap_fast_key_create);
+  pthread_setspecific(eheap_fast_key, eheap_fast_bins); // Non-NULL value, so destructor runs
+#endif
+}
+
+/*******************************************************************************
+ ** \brief  Slow path of eheap_alloc_const on empty or stale cache, allocates
+ **         block of full class size so it can be cached for class later.
+ **         Blocks cached for other classes are returned to heap if it is
+ **         exhausted.
+ ** \param  cls - size class
+ ** \retval Zeroed block or NULL
+ ******************************************************************************/
+void* eheap_fast_refill(size_t cls)
+{
+  size_t size = (cls + 1) * EHEAP_FAST_GRANULE;
+  if (eheap_fast_bins_generation != __atomic_load_n(&eheap_fast_generation, __ATOMIC_RELAXED)) eheap_fast_attach();
+  EHEAP_PROF_ENTER();
+  void* ptr = eheap_alloc(size);
+  if (!ptr && eheap_fast_flush()) ptr = eheap_alloc(size);
+  EHEAP_PROF_LEAVE();
+  return ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Return blocks cached by calling thread to heap. With
+ **         EHEAP_USE_PTHREAD it runs on thread exit; caches of replaced heap
+ **         are dropped.
+ ** \param  None
+ ** \retval Bytes returned
+ ******************************************************************************/
+size_t eheap_fast_flush(void)
+{
+  size_t released = 0;
+  if (eheap_fast_bins_generation != __atomic_load_n(&eheap_fast_generation, __ATOMIC_RELAXED))
+  {
+    memset(eheap_fast_bins, 0, sizeof(eheap_fast_bins));
+    return 0;
+  }
+  for (size_t cls = 0; cls < EHEAP_FAST_CLASSES; cls++)
+  {
+    eheap_fast_bin_t* bin = &eheap_fast_bins[cls];
+    while (bin->head)
+    {
+      void* ptr = bin->head;
+      bin->head = *(void**)ptr;
+      released += eheap_usable_size(ptr);
+      eheap_free(ptr);
+    }
+    bin->count = 0;
+  }
+  return released;
+}
+#endif
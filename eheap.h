@@ -12,13 +12,85 @@
 /*******************************************************************************
  * Include files
  ******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 /*******************************************************************************
  * Global pre-processor symbols/macros ('#define')
  ******************************************************************************/
+#ifndef EHEAP_SIZE
 #define EHEAP_SIZE         2048
-#define EHEAP_ALIGNMENT    8
+#endif
+#ifndef EHEAP_ALIGNMENT
+#define EHEAP_ALIGNMENT    8              // power of two dividing header size (16 on LP64, 8 on ILP32)
+#endif
+#define EHEAP_ENGINE_BESTFIT 0           // address ordered free list, best fit
+#define EHEAP_ENGINE_BUDDY   1            // binary buddy, power of two blocks
+#ifndef EHEAP_ENGINE
+#define EHEAP_ENGINE       EHEAP_ENGINE_BESTFIT // allocation engine
+#endif
+#ifndef EHEAP_USE_TREE_INDEX
+#define EHEAP_USE_TREE_INDEX 0            // 1 - index free blocks by size and address, O(log n) alloc and free
+#endif
+#ifndef EHEAP_USE_PTHREAD
+#define EHEAP_USE_PTHREAD  0              // 1 - guard heap with pthread mutex
+#endif
+#if EHEAP_USE_PTHREAD && defined(__cplusplus)
+#define EHEAP_TLS thread_local            // per thread state, plain static without threads
+#elif EHEAP_USE_PTHREAD
+#define EHEAP_TLS _Thread_local
+#else
+#define EHEAP_TLS
+#endif
+#ifndef EHEAP_USE_PROFILER
+#define EHEAP_USE_PROFILER 0              // 1 - sampling allocation profiler (eheap_prof.h)
+#endif
+#ifndef EHEAP_USE_OPSTATS
+#define EHEAP_USE_OPSTATS  0              // 1 - per-operation cycles and visited nodes
+#endif
+#define EHEAP_OPSTATS_BUCKETS 32          // log2 cycle histogram buckets
+#ifndef EHEAP_USE_PERSIST
+#define EHEAP_USE_PERSIST  0              // 1 - file backed heap (eheap_persist_*)
+#endif
+#ifndef EHEAP_USE_MMAP_LARGE
+#define EHEAP_USE_MMAP_LARGE 0            // 1 - serve large blocks from dedicated mappings
+#endif
+#ifndef EHEAP_MMAP_THRESHOLD
+#define EHEAP_MMAP_THRESHOLD (64 * 1024)  // smallest request served by mapping
+#endif
+#ifndef EHEAP_MMAP_MAX_REGIONS
+#define EHEAP_MMAP_MAX_REGIONS 64         // side table size
+#endif
+#ifndef EHEAP_USE_PRESSURE
+#define EHEAP_USE_PRESSURE 0              // 1 - reclaim handlers and usage watermarks
+#endif
+#ifndef EHEAP_PRESSURE_MAX_HANDLERS
+#define EHEAP_PRESSURE_MAX_HANDLERS 8     // registered reclaim handlers
+#endif
+#ifndef EHEAP_USE_FASTPATH
+#define EHEAP_USE_FASTPATH 0              // 1 - eheap_alloc_const/eheap_free_const use size class caches
+#endif
+#define EHEAP_FAST_GRANULE 16             // size class spacing
+#ifndef EHEAP_FAST_CLASSES
+#define EHEAP_FAST_CLASSES 8              // classes of 16, 32 .. 128 bytes
+#endif
+#ifndef EHEAP_FAST_CACHE_MAX
+#define EHEAP_FAST_CACHE_MAX 64           // blocks kept per class
+#endif
+#define EHEAP_FAST_FITS(size)  ((size) > 0 && (size) <= EHEAP_FAST_GRANULE * EHEAP_FAST_CLASSES)
+#define EHEAP_FAST_CLASS(size) (((size) + EHEAP_FAST_GRANULE - 1) / EHEAP_FAST_GRANULE - 1)
+#if EHEAP_USE_FASTPATH
+#define eheap_alloc_const(size)     (EHEAP_FAST_FITS(size) ? eheap_fast_pop(EHEAP_FAST_CLASS(size), (size)) : eheap_alloc(size))
+#define eheap_free_const(ptr, size) (EHEAP_FAST_FITS(size) ? eheap_fast_push((ptr), EHEAP_FAST_CLASS(size)) : eheap_free_sized((ptr), (size)))
+#else
+#define eheap_alloc_const(size)     eheap_alloc(size)
+#define eheap_free_const(ptr, size) eheap_free_sized((ptr), (size))
+#endif
+#define EHEAP_HINT_NONE        0u         // eheap_alloc_hint flags: plain best fit
+#define EHEAP_HINT_LONG_LIVED  1u         // lowest address block that fits
+#define EHEAP_HINT_SHORT_LIVED 2u         // highest address block that fits, carved from its top
 
 /*******************************************************************************
  * Global type definitions ('typedef')
@@ -31,29 +103,134 @@ typedef struct {
   size_t current_usage;
   size_t fragmentation;
   size_t largest_free_block;
+  size_t mapped_regions;             // large blocks living in dedicated mappings
+  size_t mapped_usage;               // bytes mapped for them
 } eheap_stats_t;
 
+typedef struct {
+  size_t count;
+  uint64_t cycles_max;
+  uint64_t cycles_mean;
+  uint64_t cycles_total;
+  size_t nodes_max;                  // free list nodes visited
+  size_t nodes_mean;
+  size_t nodes_total;
+  size_t cycles_hist[EHEAP_OPSTATS_BUCKETS]; // [i] counts ops with cycles in [2^i, 2^(i+1))
+} eheap_op_stats_t;
+
+typedef struct {
+  eheap_stats_t heap;
+  eheap_op_stats_t alloc;            // eheap_alloc, eheap_alloc_aligned, eheap_calloc
+  eheap_op_stats_t free;
+  eheap_op_stats_t realloc;
+} eheap_ext_stats_t;
+
+typedef size_t (*eheap_pressure_handler_t)(size_t needed, void* ctx); // returns bytes released
+typedef void (*eheap_watermark_handler_t)(bool high, size_t usage, void* ctx); // high - crossed high mark
+
+typedef struct {
+  void* head;                        // cached blocks linked through first word
+  size_t count;
+} eheap_fast_bin_t;
+
+typedef ptrdiff_t eheap_link_t;      // self-relative offset to block, 0 - none
+
 typedef struct eheap_free_block_t {
   size_t size;                       // block size including header
-  struct eheap_free_block_t* next;   // ptr to next free block
+  eheap_link_t next;                 // link to next free block
 } eheap_free_block_t;
 
 /*******************************************************************************
  * Global variable definitions ('extern')
  ******************************************************************************/
+#if EHEAP_USE_FASTPATH
+extern EHEAP_TLS eheap_fast_bin_t eheap_fast_bins[EHEAP_FAST_CLASSES];
+extern EHEAP_TLS size_t eheap_fast_bins_generation;
+extern size_t eheap_fast_generation;
+#endif
 
 /*******************************************************************************
  * Global function prototypes (definition in C source)
  ******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void eheap_init(void);
+bool eheap_init_region(void* region, size_t size);
 void* eheap_alloc(size_t size);
 void* eheap_calloc(size_t num, size_t size);
 void* eheap_realloc(void* ptr, size_t new_size);
 void eheap_free(void* ptr);
+void eheap_free_sized(void* ptr, size_t size);
+void* eheap_realloc_sized(void* ptr, size_t old_size, size_t new_size);
+size_t eheap_usable_size(void* ptr);
 void eheap_get_stats(eheap_stats_t* stats);
+void eheap_get_ext_stats(eheap_ext_stats_t* stats);
+#if EHEAP_USE_PERSIST
+bool eheap_persist_open(const char* path, size_t size);
+bool eheap_persist_checkpoint(void);
+void eheap_persist_close(void);
+void* eheap_persist_get_root(void);
+void eheap_persist_set_root(void* ptr);
+#endif
 size_t eheap_get_usage_percent(void);
 bool eheap_validate(void);
 void eheap_reset_stats(void);
 bool eheap_validate_ptr(void* ptr);
+void* eheap_alloc_aligned(size_t alignment, size_t size);
+void* eheap_alloc_hint(size_t size, unsigned int flags);
+#if EHEAP_USE_PRESSURE
+bool eheap_pressure_register(eheap_pressure_handler_t handler, void* ctx, int priority);
+bool eheap_pressure_unregister(eheap_pressure_handler_t handler, void* ctx);
+bool eheap_set_watermarks(size_t high, size_t low, eheap_watermark_handler_t handler, void* ctx);
+#endif
+#if EHEAP_USE_FASTPATH
+void* eheap_fast_refill(size_t cls);
+size_t eheap_fast_flush(void);
+
+/*******************************************************************************
+ ** \brief  Fast path of eheap_alloc_const, pops cached block of size class.
+ **         Size is compile-time constant there, so class index and zeroing
+ **         fold away.
+ ** \param  cls - size class, size - requested size
+ ** \retval Zeroed block or NULL
+ ******************************************************************************/
+static inline void* eheap_fast_pop(size_t cls, size_t size)
+{
+  eheap_fast_bin_t* bin = &eheap_fast_bins[cls];
+  void* ptr = bin->head;
+  if (!ptr || eheap_fast_bins_generation != __atomic_load_n(&eheap_fast_generation, __ATOMIC_RELAXED)) return eheap_fast_refill(cls);
+  bin->head = *(void**)ptr;
+  bin->count--;
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+/*******************************************************************************
+ ** \brief  Fast path of eheap_free_const, caches block for its size class.
+ **         Block stays allocated in heap while cached. Thread whose caches
+ **         are not set up by eheap_fast_refill for current heap frees it.
+ ** \param  ptr - block from eheap_alloc_const of same size, cls - size class
+ ** \retval None
+ ******************************************************************************/
+static inline void eheap_fast_push(void* ptr, size_t cls)
+{
+  eheap_fast_bin_t* bin = &eheap_fast_bins[cls];
+  if (!ptr) return;
+  if (bin->count >= EHEAP_FAST_CACHE_MAX || eheap_fast_bins_generation != __atomic_load_n(&eheap_fast_generation, __ATOMIC_RELAXED))
+  {
+    eheap_free(ptr);
+    return;
+  }
+  *(void**)ptr = bin->head;
+  bin->head = ptr;
+  bin->count++;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif //__EHEAP_H
@@ -0,0 +1,119 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+#ifndef __EHEAP_HPP
+#define __EHEAP_HPP
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <cstddef>
+#include <new>
+#include <memory_resource>
+#include <type_traits>
+
+#include "eheap.h"
+
+namespace eheap {
+
+/*******************************************************************************
+ * Global type definitions
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Heap binding policy for the global eheap instance. Any type with the
+ **         same static allocate/deallocate pair can be used to bind adapters
+ **         to another heap.
+ ******************************************************************************/
+struct global_heap {
+  static void* allocate(std::size_t bytes, std::size_t alignment) noexcept
+  {
+    if (bytes == 0) bytes = 1;
+    if (alignment <= EHEAP_ALIGNMENT) return eheap_alloc(bytes);
+    return eheap_alloc_aligned(alignment, bytes);
+  }
+  static void deallocate(void* ptr) noexcept
+  {
+    eheap_free(ptr);
+  }
+};
+
+/*******************************************************************************
+ ** \brief  std::pmr::memory_resource backed by heap policy Heap
+ ******************************************************************************/
+template <class Heap = global_heap>
+class basic_memory_resource final : public std::pmr::memory_resource {
+public:
+  basic_memory_resource() noexcept = default;
+
+  static basic_memory_resource* instance() noexcept
+  {
+    static basic_memory_resource resource;
+    return &resource;
+  }
+
+protected:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    void* ptr = Heap::allocate(bytes, alignment);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+  }
+
+  void do_deallocate(void* ptr, std::size_t, std::size_t) override
+  {
+    Heap::deallocate(ptr);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return dynamic_cast<const basic_memory_resource*>(&other) != nullptr; // Same policy means same heap
+  }
+};
+
+using memory_resource = basic_memory_resource<global_heap>;
+
+/*******************************************************************************
+ ** \brief  Stateless STL allocator backed by heap policy Heap
+ ******************************************************************************/
+template <class T, class Heap = global_heap>
+class allocator {
+public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+
+  template <class U>
+  struct rebind { using other = allocator<U, Heap>; };
+
+  allocator() noexcept = default;
+  template <class U>
+  allocator(const allocator<U, Heap>&) noexcept {}
+
+  T* allocate(std::size_t n)
+  {
+    if (n > static_cast<std::size_t>(-1) / sizeof(T)) throw std::bad_array_new_length();
+    void* ptr = Heap::allocate(n * sizeof(T), alignof(T));
+    if (!ptr) throw std::bad_alloc();
+    return static_cast<T*>(ptr);
+  }
+
+  void deallocate(T* ptr, std::size_t) noexcept
+  {
+    Heap::deallocate(ptr);
+  }
+};
+
+template <class T, class U, class Heap>
+bool operator==(const allocator<T, Heap>&, const allocator<U, Heap>&) noexcept { return true; }
+
+template <class T, class U, class Heap>
+bool operator!=(const allocator<T, Heap>&, const allocator<U, Heap>&) noexcept { return false; }
+
+} // namespace eheap
+
+#endif //__EHEAP_HPP
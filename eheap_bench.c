@@ -0,0 +1,409 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+// Allocator micro benchmarks. Build with e.g.
+//   gcc -std=c11 -O2 -DEHEAP_SIZE=8388608 eheap.c eheap_bench.c -o eheap_bench
+// Add -DEHEAP_ENGINE=1 to run the same traces on the buddy engine, or
+// -DEHEAP_USE_TREE_INDEX=1 to run best-fit with size index, or
+// -DEHEAP_USE_FASTPATH=1 to serve eheap_alloc_const from size class caches.
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "eheap.h"
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define BENCH_VECTORS   8                 // vectors grown round robin so they interleave
+#define BENCH_ELEMENTS  (EHEAP_SIZE / (BENCH_VECTORS * 64))
+#define BENCH_ROUNDS    5
+#define BENCH_SLOTS     256               // live objects in random traces
+#define BENCH_STEPS     200000
+#define BENCH_MAX_SIZE  4096
+#define BENCH_BATCH     8                 // operations per timer reading
+#define BENCH_LOOKUPS   20000
+#define BENCH_HOLES_MAX 10000             // largest free block count
+#define BENCH_HOLE_SPAN 600               // bound of hole and live block bytes
+#define BENCH_LONG_SLOTS  (EHEAP_SIZE / 1024)  // long-lived objects fill about a quarter of heap
+#define BENCH_SHORT_SLOTS (EHEAP_SIZE / 8192)  // short-lived buffers fill about half of heap
+#define BENCH_HINT_STEPS  200000
+#define BENCH_FIXED_SIZE  48                   // compile-time constant object size
+#define BENCH_FIXED_LIVE  32                   // objects allocated before freeing them all
+#define BENCH_FIXED_ITERS 100000
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+typedef struct {
+  int* data;
+  size_t length;
+  size_t capacity;                   // elements
+} bench_vector_t;
+
+typedef void (*bench_func_t)(void);
+
+struct bench_case {
+  bench_func_t func;
+  const char* name;
+};
+
+/*******************************************************************************
+ * Local function prototypes
+ ******************************************************************************/
+static void bench_vector_growth(void);
+static void bench_engine_trace(void);
+static void bench_free_blocks(void);
+static void bench_lifetime_hints(void);
+static void bench_fixed_size(void);
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static const struct bench_case bench_cases[] = {
+  {bench_vector_growth, "Vector growth"},
+  {bench_engine_trace,  "Random alloc/free trace"},
+  {bench_free_blocks,   "Latency by free block count"},
+  {bench_lifetime_hints, "Lifetime hints"},
+  {bench_fixed_size,     "Fixed-size objects"},
+  {NULL,                NULL}
+};
+
+/*******************************************************************************
+ * Function implementation
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Monotonic time in seconds
+ ** \param  None
+ ** \retval Seconds
+ ******************************************************************************/
+static double bench_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*******************************************************************************
+ ** \brief  Append elements round robin to several vectors. Growth is either
+ **         exact (capacity is what was asked for) or slack aware (capacity is
+ **         taken from eheap_usable_size and resize passes the live length
+ **         to eheap_realloc_sized).
+ ** \param  geometric - grow by 1.5x instead of one element,
+ **         use_slack - use usable size and sized realloc/free
+ ** \retval Number of realloc calls
+ ******************************************************************************/
+static size_t bench_vector_run(bool geometric, bool use_slack)
+{
+  bench_vector_t vectors[BENCH_VECTORS] = {0};
+  size_t reallocs = 0;
+  for (int i = 0; i < BENCH_ELEMENTS; i++)
+  {
+    for (int v = 0; v < BENCH_VECTORS; v++)
+    {
+      bench_vector_t* vec = &vectors[v];
+      if (vec->length == vec->capacity)
+      {
+        size_t capacity = geometric ? vec->capacity + vec->capacity / 2 + 1 : vec->capacity + 1;
+        size_t bytes = capacity * sizeof(int);
+        int* data = use_slack
+                  ? (int*)eheap_realloc_sized(vec->data, vec->length * sizeof(int), bytes)
+                  : (int*)eheap_realloc(vec->data, bytes);
+        assert(data != NULL);
+        vec->data = data;
+        vec->capacity = use_slack ? eheap_usable_size(data) / sizeof(int) : capacity;
+        reallocs++;
+      }
+      vec->data[vec->length++] = i;
+    }
+  }
+  for (int v = 0; v < BENCH_VECTORS; v++)
+  {
+    assert(vectors[v].data[BENCH_ELEMENTS - 1] == BENCH_ELEMENTS - 1);
+    if (use_slack) eheap_free_sized(vectors[v].data, vectors[v].length * sizeof(int));
+    else eheap_free(vectors[v].data);
+  }
+  return reallocs;
+}
+
+/*******************************************************************************
+ ** \brief  Vector growth with and without usable size slack
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_vector_growth(void)
+{
+  static const char* growth_names[] = {"+1", "x1.5"};
+  for (int geometric = 0; geometric <= 1; geometric++)
+  {
+    for (int use_slack = 0; use_slack <= 1; use_slack++)
+    {
+      size_t reallocs = 0;
+      double best = 0;
+      for (int round = 0; round < BENCH_ROUNDS; round++)
+      {
+        eheap_init();
+        double start = bench_now();
+        reallocs = bench_vector_run(geometric, use_slack);
+        double elapsed = bench_now() - start;
+        if (round == 0 || elapsed < best) best = elapsed;
+      }
+      printf("  growth %-4s %-12s reallocs %8zu  %8.3f ms\n", growth_names[geometric],
+             use_slack ? "usable_size" : "exact", reallocs, best * 1e3);
+    }
+  }
+}
+
+/*******************************************************************************
+ ** \brief  Deterministic pseudo random numbers (xorshift32)
+ ** \param  state - generator state, not 0
+ ** \retval Next value
+ ******************************************************************************/
+static uint32_t bench_random(uint32_t* state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+/*******************************************************************************
+ ** \brief  Random trace over fixed set of slots, each step frees occupied slot
+ **         or fills empty one. Reports latency per operation and internal
+ **         fragmentation: bytes held by live blocks beyond what was requested.
+ ** \param  pow2 - request power of two sizes instead of arbitrary sizes
+ ** \retval None
+ ******************************************************************************/
+static void bench_trace_run(bool pow2)
+{
+  static void* ptrs[BENCH_SLOTS];
+  static size_t sizes[BENCH_SLOTS];
+  double best = 0;
+  size_t requested = 0;
+  size_t held = 0;
+  eheap_stats_t stats = {0};
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    uint32_t rng = 2463534242u;
+    memset(ptrs, 0, sizeof(ptrs));
+    eheap_init();
+    double start = bench_now();
+    for (int step = 0; step < BENCH_STEPS; step++)
+    {
+      uint32_t slot = bench_random(&rng) % BENCH_SLOTS;
+      if (ptrs[slot])
+      {
+        eheap_free(ptrs[slot]);
+        ptrs[slot] = NULL;
+        continue;
+      }
+      uint32_t r = bench_random(&rng);
+      sizes[slot] = pow2 ? (size_t)16 << (r % 9) : 1 + r % BENCH_MAX_SIZE;
+      ptrs[slot] = eheap_alloc(sizes[slot]);
+    }
+    double elapsed = bench_now() - start;
+    if (round == 0 || elapsed < best) best = elapsed;
+    requested = 0;
+    held = 0;
+    for (int slot = 0; slot < BENCH_SLOTS; slot++)
+    {
+      if (!ptrs[slot]) continue;
+      requested += sizes[slot];
+      held += eheap_usable_size(ptrs[slot]) + sizeof(eheap_free_block_t);
+    }
+    eheap_get_stats(&stats);
+  }
+  printf("  %-9s %7.1f ns/op  internal frag %5.1f%%  usage %8zu  peak %8zu  failures %zu\n",
+         pow2 ? "pow2" : "arbitrary", best * 1e9 / BENCH_STEPS,
+         held ? 100.0 * (double)(held - requested) / (double)held : 0.0,
+         stats.current_usage, stats.peak_usage, stats.alloc_failures);
+}
+
+/*******************************************************************************
+ ** \brief  Latency and internal fragmentation of compiled engine
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_engine_trace(void)
+{
+  printf("  engine %s\n", EHEAP_ENGINE == EHEAP_ENGINE_BUDDY ? "buddy" : "best-fit");
+  bench_trace_run(true);
+  bench_trace_run(false);
+}
+
+/*******************************************************************************
+ ** \brief  Leave holes free blocks of varied size separated by live blocks,
+ **         then time allocations served from them and frees returning them
+ ** \param  holes - number of free blocks
+ ** \retval None
+ ******************************************************************************/
+static void bench_free_blocks_run(int holes)
+{
+  static void* blocks[2 * BENCH_HOLES_MAX];
+  void* batch[BENCH_BATCH];
+  uint32_t rng = 88172645u;
+  eheap_init();
+  for (int i = 0; i < holes; i++) // Allocate all first, so freed holes are not reused
+  {
+    blocks[2 * i] = eheap_alloc(32 + (size_t)(i % 61) * 8);
+    blocks[2 * i + 1] = eheap_alloc(16);
+    assert(blocks[2 * i] != NULL && blocks[2 * i + 1] != NULL);
+  }
+  for (int i = 0; i < holes; i++) eheap_free(blocks[2 * i]);
+  double alloc_time = 0;
+  double free_time = 0;
+  for (int i = 0; i < BENCH_LOOKUPS; i += BENCH_BATCH)
+  {
+    double start = bench_now();
+    for (int j = 0; j < BENCH_BATCH; j++) batch[j] = eheap_alloc(32 + (bench_random(&rng) % 61) * 8);
+    double middle = bench_now();
+    for (int j = 0; j < BENCH_BATCH; j++) eheap_free(batch[j]);
+    free_time += bench_now() - middle;
+    alloc_time += middle - start;
+  }
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  printf("  %6d free blocks  alloc %8.1f ns  free %8.1f ns  failures %zu\n", holes,
+         alloc_time * 1e9 / BENCH_LOOKUPS, free_time * 1e9 / BENCH_LOOKUPS, stats.alloc_failures);
+}
+
+/*******************************************************************************
+ ** \brief  Allocation and free latency at 10, 100 and 10k free blocks
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_free_blocks(void)
+{
+  printf("  size index %s\n", EHEAP_USE_TREE_INDEX ? "tree" : "none");
+  bench_free_blocks_run(10);
+  bench_free_blocks_run(100);
+  if (EHEAP_SIZE >= BENCH_HOLES_MAX * BENCH_HOLE_SPAN) bench_free_blocks_run(BENCH_HOLES_MAX);
+  else printf("  %d free blocks need EHEAP_SIZE of %d bytes or more\n", BENCH_HOLES_MAX, BENCH_HOLES_MAX * BENCH_HOLE_SPAN);
+}
+
+/*******************************************************************************
+ ** \brief  Long randomized trace mixing long-lived small objects, replaced
+ **         rarely, with short-lived buffers churned every step. Reports lowest
+ **         largest free block seen after warm-up and allocation failures.
+ ** \param  use_hints - pass lifetime flags instead of EHEAP_HINT_NONE
+ ** \retval None
+ ******************************************************************************/
+static void bench_lifetime_run(bool use_hints)
+{
+  static void* long_ptrs[BENCH_LONG_SLOTS];
+  static void* short_ptrs[BENCH_SHORT_SLOTS];
+  unsigned int long_flags = use_hints ? EHEAP_HINT_LONG_LIVED : EHEAP_HINT_NONE;
+  unsigned int short_flags = use_hints ? EHEAP_HINT_SHORT_LIVED : EHEAP_HINT_NONE;
+  uint32_t rng = 1597334677u;
+  size_t lowest_largest = SIZE_MAX;
+  eheap_stats_t stats;
+  memset(long_ptrs, 0, sizeof(long_ptrs));
+  memset(short_ptrs, 0, sizeof(short_ptrs));
+  eheap_init();
+  double start = bench_now();
+  for (int step = 0; step < BENCH_HINT_STEPS; step++)
+  {
+    uint32_t r = bench_random(&rng);
+    if (r % 16 == 0)
+    {
+      uint32_t slot = (r >> 8) % BENCH_LONG_SLOTS;
+      if (long_ptrs[slot]) eheap_free(long_ptrs[slot]);
+      long_ptrs[slot] = eheap_alloc_hint(32 + (r >> 20) % 480, long_flags);
+    }
+    else
+    {
+      uint32_t slot = (r >> 8) % BENCH_SHORT_SLOTS;
+      if (short_ptrs[slot]) { eheap_free(short_ptrs[slot]); short_ptrs[slot] = NULL; continue; }
+      short_ptrs[slot] = eheap_alloc_hint(256 + (r >> 16) % 16128, short_flags);
+    }
+    if (step >= BENCH_HINT_STEPS / 4 && step % 64 == 0)
+    {
+      eheap_get_stats(&stats);
+      if (stats.largest_free_block < lowest_largest) lowest_largest = stats.largest_free_block;
+    }
+  }
+  double elapsed = bench_now() - start;
+  eheap_get_stats(&stats);
+  printf("  %-9s %7.1f ns/op  lowest largest free %8zu  usage %8zu  failures %zu\n",
+         use_hints ? "hinted" : "unhinted", elapsed * 1e9 / BENCH_HINT_STEPS,
+         lowest_largest, stats.current_usage, stats.alloc_failures);
+}
+
+/*******************************************************************************
+ ** \brief  Same trace with and without lifetime hints
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_lifetime_hints(void)
+{
+  bench_lifetime_run(false);
+  bench_lifetime_run(true);
+}
+
+/*******************************************************************************
+ ** \brief  Allocate and free batches of equal, compile-time sized objects
+ **         through eheap_alloc/eheap_free and eheap_alloc_const/eheap_free_const
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void bench_fixed_size(void)
+{
+  static void* ptrs[BENCH_FIXED_LIVE];
+  printf("  fast path %s, %d byte objects\n", EHEAP_USE_FASTPATH ? "on" : "off", BENCH_FIXED_SIZE);
+  for (int use_const = 0; use_const <= 1; use_const++)
+  {
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+      eheap_init();
+      double start = bench_now();
+      for (int i = 0; i < BENCH_FIXED_ITERS; i++)
+      {
+        if (use_const)
+        {
+          for (int j = 0; j < BENCH_FIXED_LIVE; j++) ptrs[j] = eheap_alloc_const(BENCH_FIXED_SIZE);
+          for (int j = 0; j < BENCH_FIXED_LIVE; j++) eheap_free_const(ptrs[j], BENCH_FIXED_SIZE);
+        }
+        else
+        {
+          for (int j = 0; j < BENCH_FIXED_LIVE; j++) ptrs[j] = eheap_alloc(BENCH_FIXED_SIZE);
+          for (int j = 0; j < BENCH_FIXED_LIVE; j++) eheap_free(ptrs[j]);
+        }
+      }
+      double elapsed = bench_now() - start;
+      if (round == 0 || elapsed < best) best = elapsed;
+      assert(ptrs[0] != NULL);
+    }
+    printf("  %-17s %7.1f ns per alloc+free\n", use_const ? "eheap_alloc_const" : "eheap_alloc",
+           best * 1e9 / ((double)BENCH_FIXED_ITERS * BENCH_FIXED_LIVE));
+  }
+}
+
+/*******************************************************************************
+ ** \brief  Run all benchmarks
+ ** \param  None
+ ** \retval 0
+ ******************************************************************************/
+int main(void)
+{
+  printf("eHeap benchmarks, heap size %d bytes\n", EHEAP_SIZE);
+  for (int i = 0; bench_cases[i].func != NULL; i++)
+  {
+    printf("%s\n", bench_cases[i].name);
+    bench_cases[i].func();
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+// Container benchmarks, eheap resource vs default allocator. Build with e.g.
+//   g++ -std=c++17 -O2 -DEHEAP_SIZE=8388608 -x c eheap.c -x c++ eheap_bench.cpp
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "eheap.hpp"
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define BENCH_ELEMENTS  (EHEAP_SIZE / 1024)
+#define BENCH_ROUNDS    5
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+typedef double (*bench_func_t)(std::pmr::memory_resource* resource);
+
+struct bench_case {
+  bench_func_t func;
+  const char* name;
+};
+
+/*******************************************************************************
+ * Function implementation
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Seconds elapsed since start
+ ******************************************************************************/
+static double bench_elapsed(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*******************************************************************************
+ ** \brief  push_back growth of std::pmr::vector
+ ******************************************************************************/
+static double bench_vector(std::pmr::memory_resource* resource)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 100; round++)
+  {
+    std::pmr::vector<int> vec(resource);
+    for (int i = 0; i < BENCH_ELEMENTS; i++) vec.push_back(i);
+    assert(vec.back() == BENCH_ELEMENTS - 1);
+  }
+  return bench_elapsed(start);
+}
+
+/*******************************************************************************
+ ** \brief  Insert, lookup and erase on std::pmr::map
+ ******************************************************************************/
+static double bench_map(std::pmr::memory_resource* resource)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::pmr::map<int, int> map(resource);
+  for (int i = 0; i < BENCH_ELEMENTS; i++) map[(i * 7919) % BENCH_ELEMENTS] = i;
+  for (int i = 0; i < BENCH_ELEMENTS; i++) assert(map.count(i) == 1);
+  for (int i = 0; i < BENCH_ELEMENTS; i += 2) map.erase(i);
+  assert(map.size() == BENCH_ELEMENTS / 2);
+  return bench_elapsed(start);
+}
+
+/*******************************************************************************
+ ** \brief  Insert, lookup and erase on std::pmr::unordered_map
+ ******************************************************************************/
+static double bench_unordered_map(std::pmr::memory_resource* resource)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::pmr::unordered_map<int, int> map(resource);
+  for (int i = 0; i < BENCH_ELEMENTS; i++) map[(i * 7919) % BENCH_ELEMENTS] = i;
+  for (int i = 0; i < BENCH_ELEMENTS; i++) assert(map.count(i) == 1);
+  for (int i = 0; i < BENCH_ELEMENTS; i += 2) map.erase(i);
+  assert(map.size() == BENCH_ELEMENTS / 2);
+  return bench_elapsed(start);
+}
+
+static const bench_case bench_cases[] = {
+  {bench_vector,        "pmr::vector push_back"},
+  {bench_map,           "pmr::map insert/erase"},
+  {bench_unordered_map, "pmr::unordered_map insert/erase"},
+  {nullptr,             nullptr}
+};
+
+/*******************************************************************************
+ ** \brief  Best of BENCH_ROUNDS runs, heap is reinitialized before each run
+ ******************************************************************************/
+static double bench_best(bench_func_t func, std::pmr::memory_resource* resource)
+{
+  double best = 1e30;
+  for (int round = 0; round < BENCH_ROUNDS; round++)
+  {
+    eheap_init();
+    double t = func(resource);
+    if (t < best) best = t;
+  }
+  return best;
+}
+
+int main()
+{
+  std::printf("eHeap container benchmarks (heap %d bytes, %d elements)\n", EHEAP_SIZE, BENCH_ELEMENTS);
+  std::printf("%-35s %12s %12s\n", "workload", "default ms", "eheap ms");
+  for (int i = 0; bench_cases[i].func != nullptr; i++)
+  {
+    double def = bench_best(bench_cases[i].func, std::pmr::new_delete_resource());
+    double eh  = bench_best(bench_cases[i].func, eheap::memory_resource::instance());
+    std::printf("%-35s %12.3f %12.3f\n", bench_cases[i].name, def * 1e3, eh * 1e3);
+  }
+  eheap_init();
+  std::vector<long, eheap::allocator<long>> vec; // Stateless allocator path
+  for (long i = 0; i < 64; i++) vec.push_back(i);
+  assert(vec[63] == 63);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+// malloc family interposer for LD_PRELOAD. Build with e.g.
+//   gcc -O2 -shared -fPIC -DEHEAP_USE_PTHREAD=1 -DEHEAP_ALIGNMENT=16 eheap.c eheap_preload.c -o libeheap.so -lpthread
+// Heap region size is taken from EHEAP_PRELOAD_SIZE environment variable.
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "eheap.h"
+
+#if !EHEAP_USE_PTHREAD
+#error "eheap_preload.c requires EHEAP_USE_PTHREAD=1"
+#endif
+_Static_assert(EHEAP_ALIGNMENT >= _Alignof(max_align_t), "malloc must be aligned for max_align_t, build with -DEHEAP_ALIGNMENT=16");
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define EHEAP_PRELOAD_DEFAULT_SIZE  ((size_t)1 << 30)  // reserved only, pages are committed on touch
+#define EHEAP_PRELOAD_EXPORT        __attribute__((visibility("default")))
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static pthread_once_t eheap_preload_once = PTHREAD_ONCE_INIT;
+static bool eheap_preload_ready = false;
+
+/*******************************************************************************
+ * Function implementation
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Map heap region and initialize heap. Runs once, uses only getenv,
+ **         mmap and eheap itself, so it is safe on the very first allocation
+ **         done by loader or libc (no dlsym, no libc malloc needed).
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_preload_init(void)
+{
+  size_t size = EHEAP_PRELOAD_DEFAULT_SIZE;
+  const char* env = getenv("EHEAP_PRELOAD_SIZE");
+  if (env)
+  {
+    size_t value = 0;
+    for (; *env >= '0' && *env <= '9'; env++) value = value * 10 + (size_t)(*env - '0');
+    if (value) size = value;
+  }
+  void* region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (region == MAP_FAILED) return;
+  eheap_preload_ready = eheap_init_region(region, size);
+}
+
+/*******************************************************************************
+ ** \brief  Ensure heap is initialized
+ ** \param  None
+ ** \retval true if heap is usable
+ ******************************************************************************/
+static bool eheap_preload_ensure(void)
+{
+  pthread_once(&eheap_preload_once, eheap_preload_init);
+  return eheap_preload_ready;
+}
+
+/*******************************************************************************
+ ** \brief  Aligned allocation shared by posix_memalign/aligned_alloc/memalign
+ ** \param  alignment - power of two alignment, size - requested size
+ ** \retval Pointer or NULL
+ ******************************************************************************/
+static void* eheap_preload_aligned(size_t alignment, size_t size)
+{
+  if (!eheap_preload_ensure()) return NULL;
+  return eheap_alloc_aligned(alignment, size ? size : 1);
+}
+
+EHEAP_PRELOAD_EXPORT void* malloc(size_t size)
+{
+  if (!eheap_preload_ensure()) { errno = ENOMEM; return NULL; }
+  void* ptr = eheap_alloc(size ? size : 1);
+  if (!ptr) errno = ENOMEM;
+  return ptr;
+}
+
+EHEAP_PRELOAD_EXPORT void free(void* ptr)
+{
+  if (ptr) eheap_free(ptr); // Foreign pointers fail eheap_validate_ptr and are ignored
+}
+
+EHEAP_PRELOAD_EXPORT void* calloc(size_t num, size_t size)
+{
+  if (!eheap_preload_ensure()) { errno = ENOMEM; return NULL; }
+  void* ptr = (num && size) ? eheap_calloc(num, size) : eheap_alloc(1);
+  if (!ptr) errno = ENOMEM;
+  return ptr;
+}
+
+EHEAP_PRELOAD_EXPORT void* realloc(void* ptr, size_t size)
+{
+  if (!ptr) return malloc(size);
+  if (size == 0) { free(ptr); return NULL; }
+  void* new_ptr = eheap_realloc(ptr, size);
+  if (!new_ptr) errno = ENOMEM;
+  return new_ptr;
+}
+
+EHEAP_PRELOAD_EXPORT void* reallocarray(void* ptr, size_t num, size_t size)
+{
+  if (size && num > SIZE_MAX / size) { errno = ENOMEM; return NULL; }
+  return realloc(ptr, num * size);
+}
+
+EHEAP_PRELOAD_EXPORT int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+  void* ptr = eheap_preload_aligned(alignment, size);
+  if (!ptr) return ENOMEM;
+  *memptr = ptr;
+  return 0;
+}
+
+EHEAP_PRELOAD_EXPORT void* aligned_alloc(size_t alignment, size_t size)
+{
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0) { errno = EINVAL; return NULL; }
+  void* ptr = eheap_preload_aligned(alignment, size);
+  if (!ptr) errno = ENOMEM;
+  return ptr;
+}
+
+EHEAP_PRELOAD_EXPORT void* memalign(size_t alignment, size_t size)
+{
+  return aligned_alloc(alignment, size);
+}
+
+EHEAP_PRELOAD_EXPORT void* valloc(size_t size)
+{
+  return aligned_alloc((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+EHEAP_PRELOAD_EXPORT void* pvalloc(size_t size)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  return aligned_alloc(page, (size + page - 1) & ~(page - 1));
+}
+
+EHEAP_PRELOAD_EXPORT size_t malloc_usable_size(void* ptr)
+{
+  return eheap_usable_size(ptr);
+}
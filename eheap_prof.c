@@ -0,0 +1,317 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+// Sampling allocation profiler. Roughly one allocation per EHEAP_PROF_DEFAULT_RATE
+// bytes records its backtrace; live samples are exported as folded stacks
+// ("root;...;leaf bytes") for flamegraph.pl / pprof. Link with -rdynamic to
+// get function names instead of module+offset frames.
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+
+#include "eheap.h"
+#include "eheap_prof.h"
+
+#if EHEAP_USE_PTHREAD
+#include <pthread.h>
+#endif
+
+/*******************************************************************************
+ * Local pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#define EHEAP_PROF_SKIP_FRAMES  2         // eheap_prof_on_alloc and allocator entry, caller unknown
+#define EHEAP_PROF_MAX_INTERNAL 8         // allocator frames that may sit above caller
+
+/*******************************************************************************
+ * Local types definitions
+ ******************************************************************************/
+typedef struct {
+  void* ptr;                         // NULL - slot is free
+  size_t size;
+  size_t weight;                     // estimated bytes this sample stands for
+  int depth;
+  void* frames[EHEAP_PROF_MAX_FRAMES];
+} eheap_prof_sample_t;
+
+/*******************************************************************************
+ * Local variable definitions ('static')
+ ******************************************************************************/
+static eheap_prof_sample_t eheap_prof_samples[EHEAP_PROF_MAX_SAMPLES];
+static bool eheap_prof_emitted[EHEAP_PROF_MAX_SAMPLES];
+static eheap_prof_stats_t eheap_prof_stats = {0};
+static atomic_size_t eheap_prof_rate = EHEAP_PROF_DEFAULT_RATE;
+static EHEAP_TLS size_t eheap_prof_countdown = 0;
+static EHEAP_TLS uint32_t eheap_prof_rng = 0;
+static EHEAP_TLS bool eheap_prof_busy = false; // Reentrancy guard for backtrace/writer allocations
+#if EHEAP_USE_PTHREAD
+static pthread_mutex_t eheap_prof_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*******************************************************************************
+ * Function implementation
+ ******************************************************************************/
+/*******************************************************************************
+ ** \brief  Lock/unlock sample table
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static void eheap_prof_lock(void)
+{
+#if EHEAP_USE_PTHREAD
+  pthread_mutex_lock(&eheap_prof_mutex);
+#endif
+}
+
+static void eheap_prof_unlock(void)
+{
+#if EHEAP_USE_PTHREAD
+  pthread_mutex_unlock(&eheap_prof_mutex);
+#endif
+}
+
+#if EHEAP_USE_PTHREAD
+/*******************************************************************************
+ ** \brief  Fork handlers, run from heap fork handlers so sample table lock is
+ **         taken before heap lock, as writer callbacks may allocate
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_atfork_prepare(void)
+{
+  pthread_mutex_lock(&eheap_prof_mutex);
+}
+
+void eheap_prof_atfork_parent(void)
+{
+  pthread_mutex_unlock(&eheap_prof_mutex);
+}
+
+void eheap_prof_atfork_child(void)
+{
+  pthread_mutex_init(&eheap_prof_mutex, NULL);
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  Next sampling distance, uniform in [1, 2 * rate] so mean is rate
+ ** \param  rate - mean distance in bytes
+ ** \retval Bytes until next sample
+ ******************************************************************************/
+static size_t eheap_prof_next_interval(size_t rate)
+{
+  if (eheap_prof_rng == 0) eheap_prof_rng = (uint32_t)(uintptr_t)&eheap_prof_rng | 1u;
+  eheap_prof_rng ^= eheap_prof_rng << 13; // xorshift32
+  eheap_prof_rng ^= eheap_prof_rng >> 17;
+  eheap_prof_rng ^= eheap_prof_rng << 5;
+  if (rate <= 1) return 1;
+  return 1 + (size_t)(((uint64_t)eheap_prof_rng * (2 * (uint64_t)rate - 1)) >> 32);
+}
+
+/*******************************************************************************
+ ** \brief  Set mean sampling distance in bytes, 0 disables sampling
+ ** \param  bytes - mean bytes allocated between samples
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_set_rate(size_t bytes)
+{
+  atomic_store_explicit(&eheap_prof_rate, bytes, memory_order_relaxed);
+  eheap_prof_countdown = 0;
+}
+
+/*******************************************************************************
+ ** \brief  Allocation hook. Fast path is one thread local subtraction, stack
+ **         is captured only when the byte countdown expires.
+ ** \param  ptr - user pointer, size - requested size, caller - return address
+ **         into application recorded by outermost allocator entry, NULL if
+ **         unknown. Stack is cut at it, so recorded leaf is the call site
+ **         whatever path led through allocator.
+ ** \retval true if allocation was sampled and must be reported on free
+ ******************************************************************************/
+__attribute__((noinline)) bool eheap_prof_on_alloc(void* ptr, size_t size, void* caller)
+{
+  size_t rate = atomic_load_explicit(&eheap_prof_rate, memory_order_relaxed);
+  if (rate == 0 || eheap_prof_busy) return false;
+  if (eheap_prof_countdown == 0) eheap_prof_countdown = eheap_prof_next_interval(rate);
+  if (size < eheap_prof_countdown)
+  {
+    eheap_prof_countdown -= size;
+    return false;
+  }
+  eheap_prof_countdown = eheap_prof_next_interval(rate);
+  eheap_prof_busy = true;
+  void* frames[EHEAP_PROF_MAX_FRAMES + EHEAP_PROF_MAX_INTERNAL];
+  int captured = backtrace(frames, EHEAP_PROF_MAX_FRAMES + EHEAP_PROF_MAX_INTERNAL);
+  int skip = EHEAP_PROF_SKIP_FRAMES;
+  for (int i = 1; caller && i < captured; i++) // Drop allocator frames above call site
+  {
+    if (frames[i] != caller) continue;
+    skip = i;
+    break;
+  }
+  int depth = captured - skip;
+  if (depth > EHEAP_PROF_MAX_FRAMES) depth = EHEAP_PROF_MAX_FRAMES;
+  if (depth < 0) depth = 0;
+  bool recorded = false;
+  eheap_prof_lock();
+  eheap_prof_stats.samples_taken++;
+  for (int i = 0; i < EHEAP_PROF_MAX_SAMPLES; i++)
+  {
+    eheap_prof_sample_t* sample = &eheap_prof_samples[i];
+    if (sample->ptr) continue;
+    sample->ptr = ptr;
+    sample->size = size;
+    sample->weight = size > rate ? size : rate;
+    sample->depth = depth;
+    memcpy(sample->frames, frames + skip, (size_t)depth * sizeof(void*));
+    eheap_prof_stats.samples_live++;
+    eheap_prof_stats.live_bytes_estimate += sample->weight;
+    recorded = true;
+    break;
+  }
+  if (!recorded) eheap_prof_stats.samples_dropped++;
+  eheap_prof_unlock();
+  eheap_prof_busy = false;
+  return recorded;
+}
+
+/*******************************************************************************
+ ** \brief  Sampled block was resized without copy (in place or remapped)
+ ** \param  old_ptr - user pointer before resize, new_ptr - after resize,
+ **         size - new requested size
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_on_resize(void* old_ptr, void* new_ptr, size_t size)
+{
+  eheap_prof_lock();
+  for (int i = 0; i < EHEAP_PROF_MAX_SAMPLES; i++)
+  {
+    eheap_prof_sample_t* sample = &eheap_prof_samples[i];
+    if (sample->ptr != old_ptr) continue;
+    sample->ptr = new_ptr;
+    if (size > sample->weight) // Keep weight an estimate of bytes at this call site
+    {
+      eheap_prof_stats.live_bytes_estimate += size - sample->weight;
+      sample->weight = size;
+    }
+    sample->size = size;
+    break;
+  }
+  eheap_prof_unlock();
+}
+
+/*******************************************************************************
+ ** \brief  Sampled block was freed
+ ** \param  ptr - user pointer
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_on_free(void* ptr)
+{
+  eheap_prof_lock();
+  for (int i = 0; i < EHEAP_PROF_MAX_SAMPLES; i++)
+  {
+    eheap_prof_sample_t* sample = &eheap_prof_samples[i];
+    if (sample->ptr != ptr) continue;
+    sample->ptr = NULL;
+    eheap_prof_stats.samples_live--;
+    eheap_prof_stats.live_bytes_estimate -= sample->weight;
+    break;
+  }
+  eheap_prof_unlock();
+}
+
+/*******************************************************************************
+ ** \brief  Get profiler counters
+ ** \param  stats - output
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_get_stats(eheap_prof_stats_t* stats)
+{
+  if (!stats) return;
+  eheap_prof_lock();
+  memcpy(stats, &eheap_prof_stats, sizeof(eheap_prof_stats));
+  eheap_prof_unlock();
+}
+
+/*******************************************************************************
+ ** \brief  Format one frame as symbol name or module+offset
+ ** \param  buf - output, len - output size, addr - return address
+ ** \retval Characters written
+ ******************************************************************************/
+static size_t eheap_prof_format_frame(char* buf, size_t len, void* addr)
+{
+  Dl_info info;
+  int n;
+  int found = dladdr(addr, &info);
+  if (found && info.dli_sname)
+  {
+    n = snprintf(buf, len, "%s", info.dli_sname);
+  }
+  else if (found && info.dli_fname && info.dli_fbase)
+  {
+    const char* module = strrchr(info.dli_fname, '/');
+    n = snprintf(buf, len, "%s+0x%lx", module ? module + 1 : info.dli_fname,
+                 (unsigned long)((uintptr_t)addr - (uintptr_t)info.dli_fbase));
+  }
+  else
+  {
+    n = snprintf(buf, len, "0x%lx", (unsigned long)(uintptr_t)addr);
+  }
+  if (n < 0) return 0;
+  return (size_t)n < len ? (size_t)n : len - 1;
+}
+
+/*******************************************************************************
+ ** \brief  Write live heap profile in folded stack format, one line per
+ **         distinct call site: "root;...;leaf estimated_bytes". Writer runs
+ **         under profiler lock and must not free eheap memory.
+ ** \param  writer - output callback, ctx - callback context
+ ** \retval None
+ ******************************************************************************/
+void eheap_prof_write_folded(eheap_prof_writer_t writer, void* ctx)
+{
+  if (!writer) return;
+  char line[EHEAP_PROF_MAX_FRAMES * 96 + 32];
+  eheap_prof_busy = true; // Writer allocations are not sampled
+  eheap_prof_lock();
+  memset(eheap_prof_emitted, 0, sizeof(eheap_prof_emitted));
+  for (int i = 0; i < EHEAP_PROF_MAX_SAMPLES; i++)
+  {
+    eheap_prof_sample_t* sample = &eheap_prof_samples[i];
+    if (!sample->ptr || eheap_prof_emitted[i]) continue;
+    size_t bytes = 0;
+    for (int j = i; j < EHEAP_PROF_MAX_SAMPLES; j++) // Aggregate identical stacks
+    {
+      eheap_prof_sample_t* other = &eheap_prof_samples[j];
+      if (!other->ptr || eheap_prof_emitted[j] || other->depth != sample->depth) continue;
+      if (memcmp(other->frames, sample->frames, (size_t)sample->depth * sizeof(void*)) != 0) continue;
+      eheap_prof_emitted[j] = true;
+      bytes += other->weight;
+    }
+    size_t pos = 0;
+    for (int f = sample->depth - 1; f >= 0; f--)
+    {
+      if (pos + 2 >= sizeof(line)) break;
+      pos += eheap_prof_format_frame(line + pos, sizeof(line) - pos - 1, sample->frames[f]);
+      if (f > 0) line[pos++] = ';';
+    }
+    int n = snprintf(line + pos, sizeof(line) - pos, "%s%zu\n", pos ? " " : "[unknown] ", bytes);
+    if (n > 0) pos += (size_t)n < sizeof(line) - pos ? (size_t)n : sizeof(line) - pos - 1;
+    writer(line, pos, ctx);
+  }
+  eheap_prof_unlock();
+  eheap_prof_busy = false;
+}
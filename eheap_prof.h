@@ -0,0 +1,64 @@
+/*******************************************************************************
+* @Ferrero                  ╔═══╦╗─╔╦═══╦═══╦═══╗               (c) 15.09.2025 *
+*                           ║╔══╣║─║║╔══╣╔═╗║╔═╗║                     v1.0.0   *
+*                           ║╚══╣╚═╝║╚══╣║─║║╚═╝║                              *
+*                           ║╔══╣╔═╗║╔══╣╚═╝║╔══╝                              *
+*                           ║╚══╣║─║║╚══╣╔═╗║║                                 *
+*                           ╚═══╩╝─╚╩═══╩╝─╚╩╝                                 *
+*******************************************************************************/
+#ifndef __EHEAP_PROF_H
+#define __EHEAP_PROF_H
+
+/*******************************************************************************
+ * Include files
+ ******************************************************************************/
+#include <stddef.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * Global pre-processor symbols/macros ('#define')
+ ******************************************************************************/
+#ifndef EHEAP_PROF_MAX_SAMPLES
+#define EHEAP_PROF_MAX_SAMPLES   512      // live samples kept at once
+#endif
+#ifndef EHEAP_PROF_MAX_FRAMES
+#define EHEAP_PROF_MAX_FRAMES    16       // stack depth per sample
+#endif
+#ifndef EHEAP_PROF_DEFAULT_RATE
+#define EHEAP_PROF_DEFAULT_RATE  (512 * 1024) // mean bytes between samples
+#endif
+
+/*******************************************************************************
+ * Global type definitions ('typedef')
+ ******************************************************************************/
+typedef void (*eheap_prof_writer_t)(const char* data, size_t len, void* ctx);
+
+typedef struct {
+  size_t samples_taken;
+  size_t samples_live;
+  size_t samples_dropped;            // table was full
+  size_t live_bytes_estimate;
+} eheap_prof_stats_t;
+
+/*******************************************************************************
+ * Global function prototypes (definition in C source)
+ ******************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void eheap_prof_set_rate(size_t bytes);
+bool eheap_prof_on_alloc(void* ptr, size_t size, void* caller);
+void eheap_prof_on_resize(void* old_ptr, void* new_ptr, size_t size);
+void eheap_prof_on_free(void* ptr);
+void eheap_prof_get_stats(eheap_prof_stats_t* stats);
+void eheap_prof_write_folded(eheap_prof_writer_t writer, void* ctx);
+void eheap_prof_atfork_prepare(void); // EHEAP_USE_PTHREAD only, called by heap fork handlers
+void eheap_prof_atfork_parent(void);
+void eheap_prof_atfork_child(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__EHEAP_PROF_H
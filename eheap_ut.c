@@ -9,6 +9,7 @@
 /*******************************************************************************
  * Include files
  ******************************************************************************/
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -16,6 +17,19 @@
 #include <stdint.h>
 
 #include "eheap.h"
+#if EHEAP_USE_PROFILER
+#include "eheap_prof.h"
+#endif
+#if EHEAP_USE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#if EHEAP_USE_PERSIST
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 /*******************************************************************************
  * Local pre-processor symbols/macros ('#define')
@@ -48,6 +62,20 @@ static bool eheap_test_validation(void);
 static bool eheap_test_stats_consistency(void);
 static bool eheap_test_double_free_protection(void);
 static bool eheap_test_boundary_conditions(void);
+static bool eheap_test_aligned_allocation(void);
+static bool eheap_test_realloc_in_place(void);
+static bool eheap_test_init_region(void);
+static bool eheap_test_profiler(void);
+static bool eheap_test_op_stats(void);
+static bool eheap_test_persist(void);
+static bool eheap_test_mmap_large(void);
+static bool eheap_test_sized_api(void);
+static bool eheap_test_buddy_engine(void);
+static bool eheap_test_best_fit_selection(void);
+static bool eheap_test_lock_free_stats(void);
+static bool eheap_test_alloc_hint(void);
+static bool eheap_test_pressure(void);
+static bool eheap_test_fast_path(void);
 
 /*******************************************************************************
  * Local types definitions
@@ -80,6 +108,20 @@ struct test_case test_cases[] = {
   {eheap_test_stats_consistency,      "Statistics consistency"},
   {eheap_test_double_free_protection, "Double free protection"},
   {eheap_test_boundary_conditions,    "Boundary conditions"},
+  {eheap_test_aligned_allocation,     "Aligned allocation"},
+  {eheap_test_realloc_in_place,       "Realloc in place"},
+  {eheap_test_init_region,            "Region initialization"},
+  {eheap_test_profiler,               "Sampling profiler"},
+  {eheap_test_op_stats,               "Operation statistics"},
+  {eheap_test_persist,                "Persistent heap"},
+  {eheap_test_mmap_large,             "Mapped large blocks"},
+  {eheap_test_sized_api,              "Usable size and sized free"},
+  {eheap_test_buddy_engine,           "Buddy engine"},
+  {eheap_test_best_fit_selection,     "Best fit selection"},
+  {eheap_test_lock_free_stats,        "Lock-free statistics"},
+  {eheap_test_alloc_hint,             "Lifetime hints"},
+  {eheap_test_pressure,               "Memory pressure"},
+  {eheap_test_fast_path,              "Inline fast path"},
   {NULL,                               NULL}
 };
 
@@ -452,6 +494,698 @@ static bool eheap_test_boundary_conditions(void)
   return true;
 }
 
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_aligned_allocation(void)
+{
+  TEST_START();
+  eheap_init();
+  void* small = eheap_alloc(8);
+  assert(small != NULL);
+  void* ptr64 = eheap_alloc_aligned(64, 100);
+  assert(ptr64 != NULL);
+  assert(((uintptr_t)ptr64 % 64) == 0);
+  void* ptr256 = eheap_alloc_aligned(256, 10);
+  assert(ptr256 != NULL);
+  assert(((uintptr_t)ptr256 % 256) == 0);
+  assert(eheap_alloc_aligned(24, 10) == NULL);
+  assert(eheap_validate() == true);
+  eheap_free(ptr64);
+  eheap_free(small);
+  eheap_free(ptr256);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_realloc_in_place(void)
+{
+  TEST_START();
+  eheap_init();
+  void* ptr1 = eheap_alloc(32);
+  void* ptr2 = eheap_alloc(256);
+  void* ptr3 = eheap_alloc(32);
+  assert(ptr1 && ptr2 && ptr3);
+  eheap_free(ptr2);
+  memset(ptr1, 0x5A, 32);
+  void* grown = eheap_realloc(ptr1, 64);
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+  assert(grown == ptr1); // Buddy engine can grow in place only into upper buddy, ptr3 holds it
+#endif
+  assert(eheap_validate() == true);
+  void* ptr4 = eheap_alloc(128);
+  assert(ptr4 != NULL);
+  memset(ptr4, 0, 128);
+  for (int i = 0; i < 32; i++)
+  {
+    assert(((uint8_t*)grown)[i] == 0x5A);
+  }
+  eheap_free(grown);
+  eheap_free(ptr3);
+  eheap_free(ptr4);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_init_region(void)
+{
+  TEST_START();
+  static uint8_t region[1024 + 3];
+  assert(eheap_init_region(region, 8) == false);
+  assert(eheap_init_region(region + 3, 1024) == true);
+  void* ptr = eheap_alloc(100);
+  assert(ptr != NULL);
+  assert((uint8_t*)ptr > region && (uint8_t*)ptr < region + sizeof(region));
+  assert(eheap_alloc(1024) == NULL);
+  assert(eheap_validate() == true);
+  eheap_free(ptr);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  eheap_init();
+  TEST_PASS();
+  return true;
+}
+
+#if EHEAP_USE_PROFILER
+/*******************************************************************************
+ ** \brief  Collects folded profile output into buffer
+ ******************************************************************************/
+static void eheap_test_prof_writer(const char* data, size_t len, void* ctx)
+{
+  char* buf = (char*)ctx;
+  size_t used = strlen(buf);
+  if (used + len >= 4096) return;
+  memcpy(buf + used, data, len);
+  buf[used + len] = 0;
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_profiler(void)
+{
+  TEST_START();
+#if EHEAP_USE_PROFILER
+  static char out[4096];
+  eheap_init();
+  eheap_prof_set_rate(1); // Sample every allocation
+  void* ptr1 = eheap_alloc(100);
+  void* ptr2 = eheap_calloc(4, 16);
+  assert(ptr1 && ptr2);
+  eheap_prof_stats_t stats;
+  eheap_prof_get_stats(&stats);
+  assert(stats.samples_live == 2);
+  assert(stats.live_bytes_estimate == 100 + 64); // Requested sizes
+  out[0] = 0;
+  eheap_prof_write_folded(eheap_test_prof_writer, out);
+  assert(strstr(out, " 100\n") != NULL);
+  assert(strstr(out, " 64\n") != NULL);
+  assert(strstr(out, "eheap_alloc") == NULL); // Leaf is call site, allocator frames are cut
+  assert(strstr(out, "eheap_calloc") == NULL);
+  eheap_free(ptr1);
+  eheap_free(ptr2);
+  eheap_prof_get_stats(&stats);
+  assert(stats.samples_live == 0);
+  assert(stats.live_bytes_estimate == 0);
+  out[0] = 0;
+  eheap_prof_write_folded(eheap_test_prof_writer, out);
+  assert(out[0] == 0);
+#if EHEAP_USE_PTHREAD
+  pid_t child = fork(); // Fork handlers leave sample table usable in child
+  assert(child >= 0);
+  if (child == 0)
+  {
+    void* sampled = eheap_alloc(48);
+    eheap_prof_get_stats(&stats);
+    _exit(sampled && stats.samples_live == 1 ? 0 : 1);
+  }
+  int status = 0;
+  assert(waitpid(child, &status, 0) == child);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+#endif
+  eheap_prof_set_rate(0);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_op_stats(void)
+{
+  TEST_START();
+  eheap_init();
+  eheap_reset_stats();
+  void* ptr1 = eheap_alloc(32);
+  void* ptr2 = eheap_alloc(32);
+  ptr1 = eheap_realloc(ptr1, 200);
+  eheap_free(ptr2);
+  eheap_free(ptr1);
+  eheap_ext_stats_t ext;
+  eheap_get_ext_stats(&ext);
+  assert(ext.heap.total_frees == 3);
+  assert(ext.heap.current_usage == 0);
+#if EHEAP_USE_OPSTATS
+  assert(ext.alloc.count == 3); // realloc moved the block
+  assert(ext.free.count == 3);
+  assert(ext.realloc.count == 1);
+  assert(ext.free.nodes_max > 0);
+  assert(ext.realloc.cycles_max >= ext.realloc.cycles_mean);
+  size_t hist_total = 0;
+  for (int i = 0; i < EHEAP_OPSTATS_BUCKETS; i++) hist_total += ext.alloc.cycles_hist[i];
+  assert(hist_total == ext.alloc.count);
+#else
+  assert(ext.alloc.count == 0);
+  assert(ext.free.count == 0);
+#endif
+  TEST_PASS();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_persist(void)
+{
+  TEST_START();
+#if EHEAP_USE_PERSIST
+  char path[] = "/tmp/eheap_ut_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+  assert(eheap_persist_open(path, 64 * 1024) == true);
+  char* text = (char*)eheap_alloc(32);
+  void* other = eheap_alloc(500);
+  assert(text && other);
+  strcpy(text, "persistent root");
+  eheap_persist_set_root(text);
+  eheap_free(other);
+  assert(eheap_persist_checkpoint() == true);
+  eheap_persist_close();
+  void* blocker = mmap(NULL, 64 * 1024, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // Push remap elsewhere
+  assert(eheap_persist_open(path, 0) == true);
+  assert(eheap_validate() == true);
+  char* root = (char*)eheap_persist_get_root();
+  assert(root != NULL);
+  assert(strcmp(root, "persistent root") == 0);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 32 + sizeof(eheap_free_block_t));
+  ((eheap_free_block_t*)root - 1)->size = 3; // Corrupt block header
+  eheap_persist_close();
+  void* keep = eheap_alloc(40); // Static heap stays active when file is rejected
+  assert(keep != NULL);
+  assert(eheap_persist_open(path, 0) == false);
+  assert(eheap_persist_open("/nonexistent/eheap", 4096) == false);
+  assert(eheap_validate_ptr(keep) == true && eheap_usable_size(keep) >= 40);
+  eheap_get_stats(&stats);
+  assert(stats.current_usage != 0);
+  eheap_free(keep);
+  assert(eheap_validate() == true);
+  munmap(blocker, 64 * 1024);
+  unlink(path);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_mmap_large(void)
+{
+  TEST_START();
+#if EHEAP_USE_MMAP_LARGE
+  eheap_init();
+  uint8_t* big = (uint8_t*)eheap_alloc(EHEAP_MMAP_THRESHOLD);
+  assert(big != NULL);
+  assert(eheap_validate_ptr(big) == true);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.mapped_regions == 1);
+  assert(stats.mapped_usage >= EHEAP_MMAP_THRESHOLD);
+  assert(stats.current_usage == 0);
+  memset(big, 0xA5, EHEAP_MMAP_THRESHOLD);
+  big = (uint8_t*)eheap_realloc(big, 4 * EHEAP_MMAP_THRESHOLD);
+  assert(big != NULL);
+  for (int i = 0; i < EHEAP_MMAP_THRESHOLD; i++)
+  {
+    assert(big[i] == 0xA5);
+  }
+  eheap_get_stats(&stats);
+  assert(stats.mapped_usage >= 4 * EHEAP_MMAP_THRESHOLD);
+  void* aligned = eheap_alloc_aligned(256, EHEAP_MMAP_THRESHOLD);
+  assert(aligned != NULL);
+  assert(((uintptr_t)aligned % 256) == 0);
+  assert(eheap_validate() == true);
+  eheap_free(big);
+  eheap_free(aligned);
+  eheap_get_stats(&stats);
+  assert(stats.mapped_regions == 0);
+  assert(stats.mapped_usage == 0);
+  assert(stats.total_frees == 2);
+  assert(eheap_validate_ptr(big) == false);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_sized_api(void)
+{
+  TEST_START();
+  eheap_init();
+  uint8_t* ptr = (uint8_t*)eheap_alloc(10);
+  assert(ptr != NULL);
+  size_t usable = eheap_usable_size(ptr);
+  assert(usable >= 10);
+  assert(usable % EHEAP_ALIGNMENT == 0);
+  memset(ptr, 0x5A, usable);
+  assert(eheap_validate() == true);
+  assert(eheap_usable_size(NULL) == 0);
+  assert(eheap_usable_size(ptr + 1) == 0);
+  eheap_free_sized(ptr, usable + EHEAP_ALIGNMENT); // Larger than block, rejected
+  uint64_t foreign[8] = { 0, 0, 64, 0 };
+  eheap_free_sized(&foreign[4], 16); // Outside the arena, rejected
+  assert(eheap_realloc_sized(&foreign[4], 16, 200) == NULL);
+  assert(eheap_validate() == true);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage > 0);
+  ptr = (uint8_t*)eheap_realloc_sized(ptr, 10, 200);
+  assert(ptr != NULL);
+  for (int i = 0; i < 10; i++)
+  {
+    assert(ptr[i] == 0x5A);
+  }
+  assert(eheap_usable_size(ptr) >= 200);
+  eheap_free_sized(ptr, 200);
+  eheap_free_sized(ptr, 200); // Double free is ignored
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(stats.largest_free_block == EHEAP_SIZE);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_buddy_engine(void)
+{
+  TEST_START();
+#if EHEAP_ENGINE == EHEAP_ENGINE_BUDDY
+  eheap_init();
+  eheap_stats_t stats;
+  uint8_t* small = (uint8_t*)eheap_alloc(1);
+  assert(small != NULL);
+  assert(eheap_usable_size(small) == 32 - sizeof(eheap_free_block_t));
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 32);
+  assert(stats.largest_free_block == EHEAP_SIZE / 2);
+  uint8_t* grown = (uint8_t*)eheap_realloc(small, 100); // Upper buddies are free
+  assert(grown == small);
+  assert(eheap_usable_size(grown) == 128 - sizeof(eheap_free_block_t));
+  assert(eheap_validate() == true);
+  void* aligned = eheap_alloc_aligned(128, 40);
+  assert(aligned != NULL);
+  assert(((uintptr_t)aligned % 128) == 0);
+  assert(eheap_usable_size(aligned) >= 40);
+  assert(eheap_validate() == true);
+  eheap_free(aligned);
+  eheap_free(aligned); // Double free of proxied block is ignored
+  eheap_free(grown);
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(stats.largest_free_block == EHEAP_SIZE); // Buddies merged back
+  assert(stats.fragmentation == 0);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_best_fit_selection(void)
+{
+  TEST_START();
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+  static const size_t hole_sizes[] = {256, 64, 128, 64, 512};
+  void* holes[5];
+  void* fences[5];
+  eheap_init();
+  for (int i = 0; i < 5; i++)
+  {
+    holes[i] = eheap_alloc(hole_sizes[i]);
+    fences[i] = eheap_alloc(16);
+    assert(holes[i] != NULL && fences[i] != NULL);
+  }
+  for (int i = 4; i >= 0; i--) eheap_free(holes[i]);
+  void* exact = eheap_alloc(64); // Equal sized holes are taken lowest address first
+  assert(exact == holes[1]);
+  void* other = eheap_alloc(64);
+  assert(other == holes[3]);
+  void* split = eheap_alloc(100); // Smallest hole that fits is 128
+  assert(split == holes[2]);
+  void* large = eheap_alloc(300);
+  assert(large == holes[4]);
+  assert(eheap_validate() == true);
+  eheap_free(other);
+  eheap_free(exact);
+  eheap_free(split);
+  eheap_free(large);
+  for (int i = 0; i < 5; i++) eheap_free(fences[i]);
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(stats.largest_free_block == EHEAP_SIZE);
+  assert(stats.fragmentation == 0);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+#if EHEAP_USE_PTHREAD
+static bool stats_reader_stop = false;
+
+/*******************************************************************************
+ ** \brief  Poll statistics while other thread allocates, every snapshot must
+ **         be internally consistent
+ ** \param  arg - unused
+ ** \retval Number of snapshots read
+ ******************************************************************************/
+static void* eheap_test_stats_reader(void* arg)
+{
+  (void)arg;
+  size_t reads = 0;
+  while (!__atomic_load_n(&stats_reader_stop, __ATOMIC_ACQUIRE))
+  {
+    eheap_stats_t stats;
+    eheap_get_stats(&stats);
+    assert(stats.current_usage <= stats.peak_usage);
+    assert(stats.current_usage + stats.largest_free_block <= EHEAP_SIZE);
+    assert(stats.total_frees <= stats.total_allocations);
+    assert(eheap_get_usage_percent() <= 100);
+    reads++;
+  }
+  return (void*)reads;
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_lock_free_stats(void)
+{
+  TEST_START();
+  eheap_init();
+  eheap_stats_t stats;
+  assert(eheap_alloc(0) == NULL); // Rejected before heap is locked
+  assert(eheap_alloc_aligned(24, 16) == NULL);
+  assert(eheap_calloc(SIZE_MAX / 2, 4) == NULL);
+  eheap_get_stats(&stats);
+  assert(stats.alloc_failures == 3);
+  assert(stats.total_allocations == 0);
+#if EHEAP_USE_PTHREAD
+  pthread_t reader;
+  void* reads = NULL;
+  void* ptrs[16] = {0};
+  size_t failed = 0;
+  uint32_t rng = 12345u;
+  __atomic_store_n(&stats_reader_stop, false, __ATOMIC_RELEASE);
+  assert(pthread_create(&reader, NULL, eheap_test_stats_reader, NULL) == 0);
+  for (int i = 0; i < 200000; i++)
+  {
+    rng = rng * 1103515245u + 12345u;
+    size_t slot = (rng >> 16) % 16;
+    if (ptrs[slot]) { eheap_free(ptrs[slot]); ptrs[slot] = NULL; continue; }
+    ptrs[slot] = eheap_alloc(16 + (rng >> 8) % 256);
+    if (!ptrs[slot]) failed++;
+  }
+  __atomic_store_n(&stats_reader_stop, true, __ATOMIC_RELEASE);
+  pthread_join(reader, &reads);
+  assert(reads != NULL);
+  for (int i = 0; i < 16; i++) eheap_free(ptrs[i]);
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(stats.alloc_failures == 3 + failed);
+  assert(eheap_validate() == true);
+#endif
+  TEST_PASS();
+  return true;
+}
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_alloc_hint(void)
+{
+  TEST_START();
+  eheap_init();
+  uint8_t* long1 = (uint8_t*)eheap_alloc_hint(64, EHEAP_HINT_LONG_LIVED);
+  uint8_t* short1 = (uint8_t*)eheap_alloc_hint(64, EHEAP_HINT_SHORT_LIVED);
+  uint8_t* long2 = (uint8_t*)eheap_alloc_hint(64, EHEAP_HINT_LONG_LIVED);
+  uint8_t* short2 = (uint8_t*)eheap_alloc_hint(64, EHEAP_HINT_SHORT_LIVED);
+  uint8_t* plain = (uint8_t*)eheap_alloc_hint(64, EHEAP_HINT_NONE);
+  assert(long1 && short1 && long2 && short2 && plain);
+  assert(eheap_alloc_hint(0, EHEAP_HINT_SHORT_LIVED) == NULL);
+  eheap_stats_t stats;
+#if EHEAP_ENGINE == EHEAP_ENGINE_BESTFIT
+  assert(long1 < long2 && long2 < short2 && short2 < short1); // Kinds grow from opposite ends
+  assert(short2 + eheap_usable_size(short2) + sizeof(eheap_free_block_t) == short1);
+  eheap_get_stats(&stats);
+  assert(stats.largest_free_block == EHEAP_SIZE - stats.current_usage); // One hole in between
+  eheap_free(short1);
+  eheap_free(short2);
+  eheap_get_stats(&stats);
+  assert(stats.largest_free_block == EHEAP_SIZE - stats.current_usage); // Freed top merges back
+#else
+  eheap_free(short1);
+  eheap_free(short2);
+#endif
+  eheap_free(long1);
+  eheap_free(long2);
+  eheap_free(plain);
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(stats.largest_free_block == EHEAP_SIZE);
+  assert(stats.alloc_failures == 1);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+  return true;
+}
+
+#if EHEAP_USE_PRESSURE
+static void* pressure_cache[32];
+static int pressure_calls[2];
+static int pressure_order = 0;
+static int watermark_events[2];
+
+/*******************************************************************************
+ ** \brief  Cache reclaim handler, drops one cached block per call
+ ** \param  needed - bytes wanted, ctx - index of call counter
+ ** \retval Bytes released
+ ******************************************************************************/
+static size_t eheap_test_cache_reclaim(size_t needed, void* ctx)
+{
+  (void)needed;
+  pressure_calls[(intptr_t)ctx] = ++pressure_order;
+  for (int i = 0; i < 32; i++)
+  {
+    if (!pressure_cache[i]) continue;
+    size_t size = eheap_usable_size(pressure_cache[i]);
+    eheap_free(pressure_cache[i]);
+    pressure_cache[i] = NULL;
+    return size;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ ** \brief  Handler that never releases anything
+ ** \param  needed - bytes wanted, ctx - index of call counter
+ ** \retval 0
+ ******************************************************************************/
+static size_t eheap_test_empty_reclaim(size_t needed, void* ctx)
+{
+  (void)needed;
+  pressure_calls[(intptr_t)ctx] = ++pressure_order;
+  return 0;
+}
+
+/*******************************************************************************
+ ** \brief  Watermark handler, counts crossings by direction
+ ** \param  high - crossed high mark, usage - current usage, ctx - unused
+ ** \retval None
+ ******************************************************************************/
+static void eheap_test_watermark(bool high, size_t usage, void* ctx)
+{
+  (void)ctx;
+  assert(high ? usage >= EHEAP_SIZE / 2 : usage <= EHEAP_SIZE / 4);
+  watermark_events[high]++;
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_pressure(void)
+{
+  TEST_START();
+#if EHEAP_USE_PRESSURE
+  eheap_init();
+  memset(pressure_cache, 0, sizeof(pressure_cache));
+  memset(pressure_calls, 0, sizeof(pressure_calls));
+  memset(watermark_events, 0, sizeof(watermark_events));
+  assert(eheap_set_watermarks(EHEAP_SIZE / 4, EHEAP_SIZE / 2, eheap_test_watermark, NULL) == false);
+  assert(eheap_set_watermarks(EHEAP_SIZE / 2, EHEAP_SIZE / 4, eheap_test_watermark, NULL) == true);
+  int cached = 0;
+  while (cached < 32 && (pressure_cache[cached] = eheap_alloc(EHEAP_SIZE / 16)) != NULL) cached++;
+  assert(cached > 4);
+  assert(watermark_events[1] == 1 && watermark_events[0] == 0); // High mark crossed once while filling
+  assert(eheap_alloc(EHEAP_SIZE / 16) == NULL); // No handler yet
+  assert(eheap_pressure_register(eheap_test_cache_reclaim, (void*)0, 1) == true);
+  assert(eheap_pressure_register(eheap_test_empty_reclaim, (void*)1, 5) == true);
+  assert(eheap_alloc(EHEAP_SIZE * 2) == NULL); // Rejected requests do not reclaim
+  assert(eheap_alloc_aligned(24, 16) == NULL);
+  assert(pressure_calls[0] == 0 && pressure_calls[1] == 0);
+  void* ptr = eheap_alloc(EHEAP_SIZE / 16);
+  assert(ptr != NULL); // Retried after cache released block
+  assert(pressure_calls[1] == 1 && pressure_calls[0] == 2); // Higher priority asked first
+  assert(eheap_pressure_unregister(eheap_test_cache_reclaim, (void*)0) == true);
+  assert(eheap_pressure_unregister(eheap_test_cache_reclaim, (void*)0) == false);
+  assert(eheap_alloc(EHEAP_SIZE / 16) == NULL); // Remaining handler releases nothing
+  assert(eheap_pressure_unregister(eheap_test_empty_reclaim, (void*)1) == true);
+  eheap_free(ptr);
+  for (int i = 0; i < 32; i++) eheap_free(pressure_cache[i]);
+  assert(watermark_events[0] == 1); // Low mark crossed once while emptying
+  eheap_stats_t stats;
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(eheap_set_watermarks(0, 0, NULL, NULL) == true);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+#else
+  TEST_SKIP();
+#endif
+  return true;
+}
+
+#if EHEAP_USE_FASTPATH && EHEAP_USE_PTHREAD
+/*******************************************************************************
+ ** \brief  Thread caching blocks of fast path, exits without flush
+ ** \param  arg - unused
+ ** \retval NULL
+ ******************************************************************************/
+static void* eheap_test_fast_worker(void* arg)
+{
+  (void)arg;
+  void* blocks[4];
+  for (int i = 0; i < 4; i++) blocks[i] = eheap_alloc_const(40);
+  for (int i = 0; i < 4; i++) eheap_free_const(blocks[i], 40);
+  return NULL;
+}
+#endif
+
+/*******************************************************************************
+ ** \brief  None
+ ** \param  None
+ ** \retval None
+ ******************************************************************************/
+static bool eheap_test_fast_path(void)
+{
+  TEST_START();
+  eheap_init();
+  eheap_stats_t stats;
+  uint8_t* small = (uint8_t*)eheap_alloc_const(24);
+  uint8_t* large = (uint8_t*)eheap_alloc_const(300); // Above largest class, plain allocation
+  assert(small != NULL && large != NULL);
+  assert(eheap_usable_size(small) >= 24);
+  memset(small, 0xA5, 24);
+  eheap_free_const(small, 24);
+  eheap_free_const(large, 300);
+#if EHEAP_USE_FASTPATH
+  assert(eheap_usable_size(small) >= 32); // Allocated with full class size
+  eheap_get_stats(&stats);
+  assert(stats.current_usage != 0); // Cached block stays allocated
+  uint8_t* reused = (uint8_t*)eheap_alloc_const(20); // Same 32 byte class
+  assert(reused == small);
+  for (int i = 0; i < 20; i++) assert(reused[i] == 0);
+  eheap_free_const(reused, 20);
+  assert(eheap_fast_flush() >= 32);
+  assert(eheap_fast_flush() == 0);
+  eheap_free_const(eheap_alloc_const(20), 20);
+  eheap_init(); // Cached block belongs to replaced heap and is dropped
+  assert(eheap_fast_flush() == 0);
+#if EHEAP_USE_PTHREAD
+  pthread_t worker;
+  assert(pthread_create(&worker, NULL, eheap_test_fast_worker, NULL) == 0);
+  pthread_join(worker, NULL); // Exit returned its caches
+#endif
+#endif
+  eheap_get_stats(&stats);
+  assert(stats.current_usage == 0);
+  assert(eheap_validate() == true);
+  TEST_PASS();
+  return true;
+}
+
 /*******************************************************************************
  ** \brief  None
  ** \param  None